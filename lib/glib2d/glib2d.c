@@ -42,9 +42,11 @@ extern void sincosf(float, float *, float *);
 
 
 #define DLIST_SIZE              (524288)
+#define DLIST_NBR               (2)
 #define LINE_SIZE               (512)
 #define PIXEL_SIZE              (4)
-#define FRAMEBUFFER_SIZE        (LINE_SIZE*G2D_SCR_H*PIXEL_SIZE)
+#define FRAMEBUFFER_SIZE        (LINE_SIZE*G2D_SCR_H*fb_pixel_size)
+#define MIP_MAX                 (8)
 #define MALLOC_STEP             (128)
 #define TSTACK_MAX              (64)
 #define SLICE_WIDTH             (64.f)
@@ -63,6 +65,19 @@ extern void sincosf(float, float *, float *);
 #define OBJ_I                   rctx.obj[i]
 #define TRANSFORM               tstack[tstack_size-1]
 
+// Stripped features read as constants, so their branches aren't compiled in
+#ifdef USE_ROTATION
+#define RCTX_USE_ROT            (rctx.use_rot)
+#else
+#define RCTX_USE_ROT            (false)
+#endif
+
+#if defined(USE_LINES) || defined(USE_QUADS) || defined(USE_POINTS)
+#define RCTX_IS_RECTS           (rctx.type == RECTS)
+#else
+#define RCTX_IS_RECTS           (true)
+#endif
+
 /* Enumerations */
 
 typedef enum
@@ -72,12 +87,14 @@ typedef enum
 
 /* Structures */
 
+#ifdef USE_TRANSFORM
 typedef struct
 {
     float x, y, z;
     float rot, rot_sin, rot_cos;
     float scale_w, scale_h;
 } Transform;
+#endif
 
 typedef struct
 {
@@ -106,18 +123,51 @@ typedef struct
     bool use_tex_linear;
     bool use_tex_repeat;
     bool use_int;
+    bool use_short_coord;
     unsigned int color_count;
     g2dCoord_Mode coord_mode;
 } RenderContext;
 
+typedef struct
+{
+    bool valid;
+    bool depth_test;
+    bool texture_2d;
+    g2dColor color;
+    int tex_filter;
+    int tex_min_filter;
+    float tex_level;
+    int tex_wrap;
+    const void *tex_data;
+    int tex_tw, tex_th;
+    int tex_psm;
+    int tex_levels;
+    bool tex_swizzled;
+} GeState;
+
 /* Local variables */
 
-static int *dlist;
+static int *dlist[DLIST_NBR];
+static int dlist_id[DLIST_NBR];
+static unsigned int dlist_cur;
+static PspGeContext ge_context;
+static g2dColor *ge_buffer = NULL;
+
+// Framebuffer pixel format, set by g2dInitMode()
+static int fb_psm = GU_PSM_8888;
+static int fb_pixel_size = 4;
+static bool use_depth = true;
+static void *depth_buffer = NULL;
+static g2dTexture *target = NULL;
 
 static RenderContext rctx;
 
+static GeState ge_state;
+
+#ifdef USE_TRANSFORM
 static Transform tstack[TSTACK_MAX];
 static unsigned int tstack_size;
+#endif
 
 static bool init = false;
 static bool start = false;
@@ -127,6 +177,17 @@ static bool scissor = false;
 
 static float global_scale;
 
+#ifdef USE_STATS
+static g2dStats stats;
+static unsigned int stats_start_time;
+static unsigned int stats_flip_time;
+static unsigned int stats_state_sent;
+static unsigned int stats_state_skipped;
+static unsigned int stats_vertices;
+static unsigned int stats_fill;
+static unsigned int stats_tex_bytes;
+#endif
+
 /* Global variables */
 
 g2dTexture g2d_draw_buffer =
@@ -135,7 +196,10 @@ g2dTexture g2d_draw_buffer =
     G2D_SCR_W, G2D_SCR_H, 
     (float)G2D_SCR_W/G2D_SCR_H,
     false, 
-    (g2dColor*)FRAMEBUFFER_SIZE
+    NULL,
+    GU_PSM_8888,
+    true,
+    1
 };
 
 g2dTexture g2d_disp_buffer =
@@ -144,22 +208,131 @@ g2dTexture g2d_disp_buffer =
     G2D_SCR_W, G2D_SCR_H, 
     (float)G2D_SCR_W/G2D_SCR_H,
     false, 
-    (g2dColor*)0
+    NULL,
+    GU_PSM_8888,
+    true,
+    1
 };
 
 /* Internal functions */
 
+/* Draw buffer, viewport and scissor back on the screen. */
+void _g2dTargetScreen()
+{
+    sceGuDrawBufferList(fb_psm, vrelptr(g2d_draw_buffer.data), LINE_SIZE);
+    sceGuOffset(2048-G2D_SCR_W/2, 2048-G2D_SCR_H/2);
+    sceGuViewport(2048, 2048, G2D_SCR_W, G2D_SCR_H);
+    g2dResetScissor();
+
+    // What was just drawn to a texture may still be in the texture cache
+    if (target != NULL)
+        sceGuTexFlush();
+
+    target = NULL;
+}
+
+
 void _g2dStart()
 {
     if (!init)
         g2dInit();
 
-    sceKernelDcacheWritebackRange(dlist, DLIST_SIZE);
-    sceGuStart(GU_DIRECT, dlist);
+#ifdef USE_STATS
+    stats_start_time = sceKernelGetSystemTimeLow();
+#endif
+
+    // The list is only sent to the GE on flip, so the framebuffer
+    // pointer isn't set by sceGuStart() and has to be emitted here, along
+    // with the rest of the screen state the last frame may have left on a
+    // render target.
+    sceGuStart(GU_SEND, dlist[dlist_cur]);
+    _g2dTargetScreen();
+
+    // Each list sets up its own state
+    ge_state.valid = false;
+
     start = true;
 }
 
 
+bool _g2dStateChanged(bool changed)
+{
+    changed = changed || !ge_state.valid;
+
+#ifdef USE_STATS
+    if (changed) stats_state_sent++;
+    else         stats_state_skipped++;
+#endif
+
+    return changed;
+}
+
+
+void _g2dDrawArray(int prim, int vtype, int count, const void *vertices)
+{
+#ifdef USE_STATS
+    stats_vertices += count;
+#endif
+
+    sceGuDrawArray(prim, vtype, count, NULL, vertices);
+}
+
+
+int _g2dTexLevelOffset(const g2dTexture *tex, int level)
+{
+    int offset = 0;
+    int l;
+
+    for (l=0; l<level; l++)
+        offset += (tex->tw >> l) * (tex->th >> l);
+
+    return offset;
+}
+
+
+/* Level to sample for the first object of the batch, from how much smaller
+ * than the texture it's drawn. */
+float _g2dTexLevel(const g2dTexture *tex)
+{
+    float ratio_w = rctx.obj[0].crop_w / fabsf(rctx.obj[0].scale_w);
+    float ratio_h = rctx.obj[0].crop_h / fabsf(rctx.obj[0].scale_h);
+    float ratio = (ratio_w < ratio_h ? ratio_w : ratio_h);
+    float level;
+
+    if (ratio <= 1.f)
+        return 0.f;
+
+    level = log2f(ratio);
+
+    return (level > tex->levels-1 ? tex->levels-1 : level);
+}
+
+
+#ifdef USE_STATS
+/* Bytes of the levels the batch samples, for the area each object covers in
+ * them. Linear mipmapping reads the two closest ones. */
+unsigned int _g2dTexBytesSampled(const g2dTexture *tex, float level)
+{
+    int pixel_size = (tex->psm == GU_PSM_8888 ? 4 : 2);
+    int l0 = (int)level;
+    int l1 = (level > l0 && rctx.use_tex_linear ? l0+1 : l0);
+    unsigned int bytes = 0;
+    unsigned int i;
+
+    for (i=0; i<rctx.n; i++)
+    {
+        unsigned int area = OBJ_I.crop_w * OBJ_I.crop_h;
+
+        bytes += (area >> (2*l0)) * pixel_size;
+        if (l1 != l0)
+            bytes += (area >> (2*l1)) * pixel_size;
+    }
+
+    return bytes;
+}
+#endif
+
+
 void* _g2dSetVertex(void *vp, int i, float vx, float vy)
 {
     // Vertex order: [texture uv] [color] [coord]
@@ -185,38 +358,100 @@ void* _g2dSetVertex(void *vp, int i, float vx, float vy)
     }
 
     // Coordinates
-    vp_float = (float*)vp_color;
+    float x = OBJ_I.x;
+    float y = OBJ_I.y;
 
-    vp_float[0] = OBJ_I.x;
-    vp_float[1] = OBJ_I.y;
-
-    if (rctx.type == RECTS)
+    if (RCTX_IS_RECTS)
     {
-        vp_float[0] += vx * OBJ_I.scale_w;
-        vp_float[1] += vy * OBJ_I.scale_h;
+        x += vx * OBJ_I.scale_w;
+        y += vy * OBJ_I.scale_h;
         
-        if (rctx.use_rot) // Apply a rotation
+        if (RCTX_USE_ROT) // Apply a rotation
         {
-            float tx = vp_float[0] - OBJ_I.rot_x;
-            float ty = vp_float[1] - OBJ_I.rot_y;
+            float tx = x - OBJ_I.rot_x;
+            float ty = y - OBJ_I.rot_y;
 
-            vp_float[0] = OBJ_I.rot_x - OBJ_I.rot_sin*ty + OBJ_I.rot_cos*tx, 
-            vp_float[1] = OBJ_I.rot_y + OBJ_I.rot_cos*ty + OBJ_I.rot_sin*tx;
+            x = OBJ_I.rot_x - OBJ_I.rot_sin*ty + OBJ_I.rot_cos*tx, 
+            y = OBJ_I.rot_y + OBJ_I.rot_cos*ty + OBJ_I.rot_sin*tx;
         }
     }
 
     if (rctx.use_int) // Pixel perfect
     {
-        vp_float[0] = floorf(vp_float[0]);
-        vp_float[1] = floorf(vp_float[1]);
+        x = floorf(x);
+        y = floorf(y);
     }
+
+    if (rctx.use_short_coord) // Already known to be whole, only rounding
+    {
+        vp_short = (short*)vp_color;
+
+        *(vp_short++) = (short)floorf(x + 0.5f);
+        *(vp_short++) = (short)floorf(y + 0.5f);
+        *(vp_short++) = (short)floorf(OBJ_I.z + 0.5f);
+
+        // Vertex size is a multiple of its largest component
+        if (rctx.use_vert_color)
+            vp_short++;
+
+        return (void*)vp_short;
+    }
+
+    vp_float = (float*)vp_color;
+
+    vp_float[0] = x;
+    vp_float[1] = y;
     vp_float[2] = OBJ_I.z;
 
     return (void*)(vp_float + 3);
 }
 
 
-#ifdef USE_VFPU
+bool _g2dIsShortCoord(float v)
+{
+    return (v >= -32768.f && v <= 32767.f && v == floorf(v));
+}
+
+
+/* Every vertex of the batch lands on a whole pixel the GE can take as a
+ * 16 bits coordinate. Only for sprites, rotations hardly ever do. */
+bool _g2dRectsFitShort()
+{
+    int i;
+
+    if (RCTX_USE_ROT)
+        return false;
+
+    for (i=0; i<rctx.n; i++)
+    {
+        float x0 = OBJ_I.x, x1 = OBJ_I.x + OBJ_I.scale_w;
+        float y0 = OBJ_I.y, y1 = OBJ_I.y + OBJ_I.scale_h;
+
+        if (!_g2dIsShortCoord(OBJ_I.z))
+            return false;
+
+        // Pixel perfect ones are floored anyway
+        if (rctx.use_int)
+        {
+            x0 = floorf(x0); x1 = floorf(x1);
+            y0 = floorf(y0); y1 = floorf(y1);
+        }
+
+        if (!_g2dIsShortCoord(x0) || !_g2dIsShortCoord(x1) ||
+            !_g2dIsShortCoord(y0) || !_g2dIsShortCoord(y1))
+            return false;
+
+        // Texture slices split the width too
+        if (rctx.tex != NULL && !rctx.use_int && OBJ_I.crop_w > SLICE_WIDTH &&
+            !_g2dIsShortCoord(SLICE_WIDTH * OBJ_I.scale_w / OBJ_I.crop_w))
+            return false;
+    }
+
+    return true;
+}
+
+
+#if defined(USE_VFPU) && defined(USE_ROTATION)
 void vfpu_sincosf(float x, float *s, float *c)
 {
     __asm__ volatile (
@@ -235,29 +470,85 @@ void vfpu_sincosf(float x, float *s, float *c)
 
 void g2dInit()
 {
+    g2dInitMode(G2D_PSM_8888);
+}
+
+
+int g2dInitMode(g2dInit_Mode mode)
+{
+    int i;
+
     if (init)
-        return;
+        return 0;
+
+    use_depth = !(mode & G2D_NO_DEPTH);
+
+    switch (mode & ~G2D_NO_DEPTH)
+    {
+        case G2D_PSM_5650: fb_psm = GU_PSM_5650; fb_pixel_size = 2; break;
+        case G2D_PSM_5551: fb_psm = GU_PSM_5551; fb_pixel_size = 2; break;
+        default:           fb_psm = GU_PSM_8888; fb_pixel_size = 4; break;
+    }
+
+    // VRAM: display buffer, draw buffer, then the 16 bits depth buffer,
+    // the rest is left to valloc()
+    g2d_disp_buffer.data = valloc(FRAMEBUFFER_SIZE);
+    g2d_draw_buffer.data = valloc(FRAMEBUFFER_SIZE);
+    g2d_disp_buffer.psm = g2d_draw_buffer.psm = fb_psm;
+    depth_buffer = (use_depth ? valloc(LINE_SIZE*G2D_SCR_H*2) : NULL);
+
+    if (g2d_disp_buffer.data == NULL || g2d_draw_buffer.data == NULL ||
+        (use_depth && depth_buffer == NULL))
+        goto error;
+
+    g2d_disp_buffer.data = vrelptr(g2d_disp_buffer.data);
+    g2d_draw_buffer.data = vrelptr(g2d_draw_buffer.data);
 
-    // Display list allocation
-    dlist = malloc(DLIST_SIZE);
+    // Display lists allocation
+    for (i=0; i<DLIST_NBR; i++)
+    {
+        dlist[i] = malloc(DLIST_SIZE);
+        dlist_id[i] = -1;
+
+        if (dlist[i] == NULL)
+        {
+            g2d_disp_buffer.data = vabsptr(g2d_disp_buffer.data);
+            g2d_draw_buffer.data = vabsptr(g2d_draw_buffer.data);
+            goto error;
+        }
+    }
+
+    dlist_cur = 0;
+    ge_buffer = NULL;
 
     // Setup GU
     sceGuInit();
-    sceGuStart(GU_DIRECT, dlist);
+    sceGuStart(GU_DIRECT, dlist[0]);
 
-    sceGuDrawBuffer(GU_PSM_8888, g2d_draw_buffer.data, LINE_SIZE);
+    sceGuDrawBuffer(fb_psm, g2d_draw_buffer.data, LINE_SIZE);
     sceGuDispBuffer(G2D_SCR_W, G2D_SCR_H, g2d_disp_buffer.data, LINE_SIZE);
-    sceGuDepthBuffer((void*)(FRAMEBUFFER_SIZE*2), LINE_SIZE);
+    if (use_depth)
+        sceGuDepthBuffer(vrelptr(depth_buffer), LINE_SIZE);
     sceGuOffset(2048-G2D_SCR_W/2, 2048-G2D_SCR_H/2);
     sceGuViewport(2048, 2048, G2D_SCR_W, G2D_SCR_H);
     
     g2d_draw_buffer.data = vabsptr(g2d_draw_buffer.data);
     g2d_disp_buffer.data = vabsptr(g2d_disp_buffer.data);
 
-    sceGuDepthRange(65535, 0);
-    sceGuClearDepth(65535);
+    if (use_depth)
+    {
+        sceGuDepthRange(65535, 0);
+        sceGuClearDepth(65535);
+        sceGuDepthFunc(GU_LEQUAL);
+    }
+    else
+    {
+        // Never touched, not even written
+        sceGuDisable(GU_DEPTH_TEST);
+        sceGuDepthMask(GU_TRUE);
+    }
+
     sceGuAlphaFunc(GU_GREATER, 0, 255);
-    sceGuDepthFunc(GU_LEQUAL);
     sceGuBlendFunc(GU_ADD, GU_SRC_ALPHA, GU_ONE_MINUS_SRC_ALPHA, 0, 0);
     sceGuTexFunc(GU_TFX_MODULATE, GU_TCC_RGBA);
     sceGuTexFilter(GU_LINEAR, GU_LINEAR);
@@ -279,18 +570,59 @@ void g2dInit()
     sceGuDisplay(GU_TRUE);
 
     init = true;
+
+    return 0;
+
+    // Out of VRAM or memory, nothing is left allocated
+error:
+    for (i=0; i<DLIST_NBR; i++)
+    {
+        free(dlist[i]);
+        dlist[i] = NULL;
+    }
+
+    if (g2d_disp_buffer.data != NULL)
+        vfree(g2d_disp_buffer.data);
+    if (g2d_draw_buffer.data != NULL)
+        vfree(g2d_draw_buffer.data);
+    if (depth_buffer != NULL)
+        vfree(depth_buffer);
+
+    g2d_disp_buffer.data = NULL;
+    g2d_draw_buffer.data = NULL;
+    depth_buffer = NULL;
+
+    return -1;
 }
 
 
 void g2dTerm()
 {
+    int i;
+
     if (!init)
         return;
- 
+
+    // Lists may still be running
+    sceGuSync(0, 0);
     sceGuTerm();
 
-    free(dlist);
+    for (i=0; i<DLIST_NBR; i++)
+    {
+        free(dlist[i]);
+        dlist[i] = NULL;
+    }
+
+    vfree(g2d_disp_buffer.data);
+    vfree(g2d_draw_buffer.data);
+    if (depth_buffer != NULL)
+        vfree(depth_buffer);
+
+    // ge_buffer is one of them
+    ge_buffer = NULL;
+    depth_buffer = NULL;
     
+    start = false;
     init = false;
 }
 
@@ -302,7 +634,7 @@ void g2dClear(g2dColor color)
     sceGuClearColor(color);
     sceGuClear(GU_COLOR_BUFFER_BIT |
                GU_FAST_CLEAR_BIT |
-               (zclear ? GU_DEPTH_BUFFER_BIT : 0));
+               (zclear && use_depth ? GU_DEPTH_BUFFER_BIT : 0));
 
     zclear = false;
 }
@@ -313,6 +645,9 @@ void g2dClearZ()
     if (!start)
         _g2dStart();
 
+    if (!use_depth)
+        return;
+
     sceGuClear(GU_DEPTH_BUFFER_BIT | GU_FAST_CLEAR_BIT);
     zclear = true;
 }
@@ -338,6 +673,7 @@ void _g2dBeginCommon(Obj_Type type, g2dTexture *tex)
     rctx.use_tex_linear = true;
     rctx.use_tex_repeat = false;
     rctx.use_int = false;
+    rctx.use_short_coord = false;
     rctx.color_count = 0;
     rctx.coord_mode = DEFAULT_COORD_MODE;
     
@@ -354,46 +690,68 @@ void g2dBeginRects(g2dTexture *tex)
 }
 
 
+#ifdef USE_LINES
 void g2dBeginLines(g2dLine_Mode mode)
 {
     _g2dBeginCommon(LINES, NULL);
     
     rctx.use_strip = (mode & G2D_STRIP);
 }
+#endif
 
 
+#ifdef USE_QUADS
 void g2dBeginQuads(g2dTexture *tex)
 {
     _g2dBeginCommon(QUADS, tex);
 }
+#endif
 
 
+#ifdef USE_POINTS
 void g2dBeginPoints()
 {
     _g2dBeginCommon(POINTS, NULL);
 }
+#endif
 
 
 void _g2dEndRects()
 {
     // Define vertices properties
-    int v_prim = (rctx.use_rot ? GU_TRIANGLES : GU_SPRITES);
-    int v_obj_nbr = (rctx.use_rot ? 6 : 2);
+    int v_prim = (RCTX_USE_ROT ? GU_TRIANGLES : GU_SPRITES);
+    int v_obj_nbr = (RCTX_USE_ROT ? 6 : 2);
     int v_nbr;
     int v_coord_size = 3;
     int v_tex_size = (rctx.tex != NULL ? 2 : 0);
     int v_color_size = (rctx.use_vert_color ? 1 : 0);
-    int v_size = v_tex_size * sizeof(short) +
+    int v_size;
+    int v_type = GU_TRANSFORM_2D;
+    int i;
+
+    // Half the coordinates' size when every position is a whole pixel
+    rctx.use_short_coord = _g2dRectsFitShort();
+
+    if (rctx.use_short_coord)
+    {
+        v_size = v_tex_size * sizeof(short) +
+                 v_color_size * sizeof(g2dColor) +
+                 (v_coord_size + v_color_size) * sizeof(short);
+        v_type |= GU_VERTEX_16BIT;
+    }
+    else
+    {
+        v_size = v_tex_size * sizeof(short) +
                  v_color_size * sizeof(g2dColor) +
                  v_coord_size * sizeof(float);
-    int v_type = GU_VERTEX_32BITF | GU_TRANSFORM_2D;
-    int i;
+        v_type |= GU_VERTEX_32BITF;
+    }
 
     if (rctx.tex != NULL)    v_type |= GU_TEXTURE_16BIT;
     if (rctx.use_vert_color) v_type |= GU_COLOR_8888;
 
     // Count how many vertices to allocate.
-    if (rctx.tex == NULL || rctx.use_rot) // No slicing
+    if (rctx.tex == NULL || RCTX_USE_ROT) // No slicing
     {
         v_nbr = v_obj_nbr * rctx.n;
     }
@@ -414,7 +772,11 @@ void _g2dEndRects()
     // Build the vertex list
     for (i=0; i<rctx.n; i+=1)
     {
-        if (rctx.use_rot) // Two triangles per object
+#ifdef USE_STATS
+        stats_fill += fabsf(OBJ_I.scale_w * OBJ_I.scale_h);
+#endif
+
+        if (RCTX_USE_ROT) // Two triangles per object
         {
             vi = _g2dSetVertex(vi, i, 0.f, 0.f);
             vi = _g2dSetVertex(vi, i, 1.f, 0.f);
@@ -442,10 +804,11 @@ void _g2dEndRects()
     }
 
     // Then put it in the display list.
-    sceGuDrawArray(v_prim, v_type, v_nbr, NULL, v);
+    _g2dDrawArray(v_prim, v_type, v_nbr, v);
 }
 
 
+#ifdef USE_LINES
 void _g2dEndLines()
 {
     // Define vertices properties
@@ -485,10 +848,12 @@ void _g2dEndLines()
     }
 
     // Then put it in the display list.
-    sceGuDrawArray(v_prim, v_type, v_nbr, NULL, v);
+    _g2dDrawArray(v_prim, v_type, v_nbr, v);
 }
+#endif
 
 
+#ifdef USE_QUADS
 void _g2dEndQuads()
 {
     // Define vertices properties
@@ -523,10 +888,12 @@ void _g2dEndQuads()
     }
 
     // Then put it in the display list.
-    sceGuDrawArray(v_prim, v_type, v_nbr, NULL, v);
+    _g2dDrawArray(v_prim, v_type, v_nbr, v);
 }
+#endif
 
 
+#ifdef USE_POINTS
 void _g2dEndPoints()
 {
     // Define vertices properties
@@ -553,8 +920,9 @@ void _g2dEndPoints()
     }
 
     // Then put it in the display list.
-    sceGuDrawArray(v_prim, v_type, v_nbr, NULL, v);
+    _g2dDrawArray(v_prim, v_type, v_nbr, v);
 }
+#endif
 
 
 void g2dEnd()
@@ -565,56 +933,135 @@ void g2dEnd()
         return;
     }
 
-    // Manage pspgu extensions
+    // Manage pspgu extensions, only what changed since the last batch
+    g2dColor color = (rctx.use_vert_color ? WHITE : rctx.cur_obj.color);
 
-    if (rctx.use_z)
-        sceGuEnable(GU_DEPTH_TEST);
-    else
-        sceGuDisable(GU_DEPTH_TEST);
+    if (use_depth && _g2dStateChanged(ge_state.depth_test != rctx.use_z))
+    {
+        if (rctx.use_z) sceGuEnable(GU_DEPTH_TEST);
+        else            sceGuDisable(GU_DEPTH_TEST);
 
-    if (rctx.use_vert_color)
-        sceGuColor(WHITE);
-    else
-        sceGuColor(rctx.cur_obj.color);
+        ge_state.depth_test = rctx.use_z;
+    }
 
-    if (rctx.tex == NULL)
-        sceGuDisable(GU_TEXTURE_2D);
-    else
+    if (_g2dStateChanged(ge_state.color != color))
+    {
+        sceGuColor(color);
+        ge_state.color = color;
+    }
+
+    if (_g2dStateChanged(ge_state.texture_2d != (rctx.tex != NULL)))
     {
-        sceGuEnable(GU_TEXTURE_2D);
+        if (rctx.tex == NULL) sceGuDisable(GU_TEXTURE_2D);
+        else                  sceGuEnable(GU_TEXTURE_2D);
 
-        if (rctx.use_tex_linear) sceGuTexFilter(GU_LINEAR, GU_LINEAR);
-        else                     sceGuTexFilter(GU_NEAREST, GU_NEAREST);
+        ge_state.texture_2d = (rctx.tex != NULL);
+    }
+
+    if (rctx.tex != NULL)
+    {
+        int filter = (rctx.use_tex_linear ? GU_LINEAR : GU_NEAREST);
+        int min_filter = filter;
+        int wrap = (rctx.use_tex_repeat ? GU_REPEAT : GU_CLAMP);
+        float level = 0.f;
+
+        if (rctx.tex->levels > 1)
+        {
+            min_filter = (rctx.use_tex_linear ? GU_LINEAR_MIPMAP_LINEAR :
+                                                GU_NEAREST_MIPMAP_NEAREST);
+            level = _g2dTexLevel(rctx.tex);
+        }
+
+        if (_g2dStateChanged(ge_state.tex_filter != filter ||
+                             ge_state.tex_min_filter != min_filter))
+        {
+            sceGuTexFilter(min_filter, filter);
+            ge_state.tex_filter = filter;
+            ge_state.tex_min_filter = min_filter;
+        }
+
+        // The whole batch is drawn from the level of its first object
+        if (rctx.tex->levels > 1 &&
+            _g2dStateChanged(ge_state.tex_level != level))
+        {
+            sceGuTexLevelMode(GU_TEXTURE_CONST, level);
+            ge_state.tex_level = level;
+        }
+
+#ifdef USE_STATS
+        stats_tex_bytes += _g2dTexBytesSampled(rctx.tex, level);
+#endif
 
-        if (rctx.use_tex_repeat) sceGuTexWrap(GU_REPEAT, GU_REPEAT);
-        else                     sceGuTexWrap(GU_CLAMP, GU_CLAMP);
+        if (_g2dStateChanged(ge_state.tex_wrap != wrap))
+        {
+            sceGuTexWrap(wrap, wrap);
+            ge_state.tex_wrap = wrap;
+        }
 
         // Load texture
-        sceGuTexMode(GU_PSM_8888, 0, 0, rctx.tex->swizzled);
-        sceGuTexImage(0, rctx.tex->tw, rctx.tex->th,
-                      rctx.tex->tw, rctx.tex->data);
+        if (_g2dStateChanged(ge_state.tex_swizzled != rctx.tex->swizzled ||
+                             ge_state.tex_psm != rctx.tex->psm ||
+                             ge_state.tex_levels != rctx.tex->levels))
+        {
+            sceGuTexMode(rctx.tex->psm, rctx.tex->levels-1, 0,
+                         rctx.tex->swizzled);
+            ge_state.tex_swizzled = rctx.tex->swizzled;
+            ge_state.tex_psm = rctx.tex->psm;
+            ge_state.tex_levels = rctx.tex->levels;
+        }
+
+        if (_g2dStateChanged(ge_state.tex_data != rctx.tex->data ||
+                             ge_state.tex_tw != rctx.tex->tw ||
+                             ge_state.tex_th != rctx.tex->th))
+        {
+            int l;
+
+            for (l=0; l<rctx.tex->levels; l++)
+            {
+                sceGuTexImage(l, rctx.tex->tw >> l, rctx.tex->th >> l,
+                              rctx.tex->tw >> l,
+                              rctx.tex->data + _g2dTexLevelOffset(rctx.tex, l));
+            }
+
+            ge_state.tex_data = rctx.tex->data;
+            ge_state.tex_tw = rctx.tex->tw;
+            ge_state.tex_th = rctx.tex->th;
+        }
     }
 
+    ge_state.valid = true;
+
+#if defined(USE_LINES) || defined(USE_QUADS) || defined(USE_POINTS)
     switch (rctx.type)
     {
         case RECTS:
             _g2dEndRects();
             break;
 
+#ifdef USE_LINES
         case LINES:
             _g2dEndLines();
             break;
+#endif
 
+#ifdef USE_QUADS
         case QUADS:
             _g2dEndQuads();
             break;
+#endif
 
+#ifdef USE_POINTS
         case POINTS:
             _g2dEndPoints();
             break;
-    }
+#endif
 
-    sceGuColor(WHITE);
+        default:
+            break;
+    }
+#else
+    _g2dEndRects();
+#endif
 
     if (rctx.use_z)
         zclear = true;
@@ -629,7 +1076,9 @@ void g2dReset()
     g2dResetScale();
     g2dResetColor();
     g2dResetAlpha();
+#ifdef USE_ROTATION
     g2dResetRotation();
+#endif
     g2dResetCrop();
     g2dResetTex();
 }
@@ -637,22 +1086,85 @@ void g2dReset()
 
 void g2dFlip(g2dFlip_Mode mode)
 {
+    unsigned int prev = (dlist_cur + 1) % DLIST_NBR;
+
+    if (!start)
+        _g2dStart();
+
     if (scissor)
         g2dResetScissor();
 
     sceGuFinish();
-    sceGuSync(0, 0);
+
+#ifdef USE_STATS
+    unsigned int t = sceKernelGetSystemTimeLow();
+
+    stats.cpu_time = t - stats_start_time;
+#endif
+
+    // Only wait for the previous frame, which was drawn while this one was
+    // built. Its display list will then be reused for the next frame.
+    if (dlist_id[prev] >= 0)
+        sceGeListSync(dlist_id[prev], 0);
+
+#ifdef USE_STATS
+    stats.ge_wait = sceKernelGetSystemTimeLow() - t;
+#endif
 
     if (mode & G2D_VSYNC)
         sceDisplayWaitVblankStart();
 
-    g2d_disp_buffer.data = g2d_draw_buffer.data;
-    g2d_draw_buffer.data = vabsptr(sceGuSwapBuffers());
+    // Show the previous frame. The GE can't draw this one before the swap,
+    // because it's queued after, so the buffer on screen is never touched.
+    if (ge_buffer != NULL)
+    {
+        // Display and GU pixel formats use the same values
+        sceDisplaySetFrameBuf(ge_buffer, LINE_SIZE, fb_psm,
+                              PSP_DISPLAY_SETBUF_IMMEDIATE);
+        g2d_disp_buffer.data = ge_buffer;
+    }
+
+    sceKernelDcacheWritebackRange(dlist[dlist_cur], DLIST_SIZE);
+    dlist_id[dlist_cur] = sceGuSendList(GU_TAIL, dlist[dlist_cur],
+                                        &ge_context);
+    dlist_cur = prev;
+
+    // The next frame goes where the one on screen is
+    ge_buffer = g2d_draw_buffer.data;
+    g2d_draw_buffer.data = g2d_disp_buffer.data;
+
+#ifdef USE_STATS
+    t = sceKernelGetSystemTimeLow();
+    stats.flip_time = t - stats_flip_time;
+    stats_flip_time = t;
+    stats.state_sent = stats_state_sent;
+    stats.state_skipped = stats_state_skipped;
+    stats.vertices = stats_vertices;
+    stats.fill = stats_fill;
+    stats.tex_bytes = stats_tex_bytes;
+    stats_state_sent = 0;
+    stats_state_skipped = 0;
+    stats_vertices = 0;
+    stats_fill = 0;
+    stats_tex_bytes = 0;
+    stats.frame++;
+#endif
 
     start = false;
 }
 
 
+void g2dGetStats(g2dStats *stats_out)
+{
+#ifdef USE_STATS
+    if (stats_out != NULL)
+        *stats_out = stats;
+#else
+    (void)stats_out;
+#endif
+}
+
+
 void g2dAdd()
 {
     if (!begin || rctx.cur_obj.scale_w == 0.f || rctx.cur_obj.scale_h == 0.f)
@@ -668,8 +1180,10 @@ void g2dAdd()
     OBJ = rctx.cur_obj;
 
     // Coordinate mode stuff
+#ifdef USE_ROTATION
     OBJ.rot_x = OBJ.x;
     OBJ.rot_y = OBJ.y;
+#endif
     
     switch (rctx.coord_mode)
     {
@@ -701,6 +1215,7 @@ void g2dAdd()
 }
 
 
+#ifdef USE_TRANSFORM
 void g2dPush()
 {
     if (tstack_size >= TSTACK_MAX)
@@ -735,9 +1250,12 @@ void g2dPop()
 
     tstack_size--;
     
+#ifdef USE_ROTATION
     if (rctx.cur_obj.rot != 0.f) rctx.use_rot = true;
+#endif
     if (rctx.cur_obj.z != 0.f)   rctx.use_z = true;
 }
+#endif
 
 /* Coord functions */
 
@@ -790,11 +1308,13 @@ void g2dSetCoordXYRelative(float x, float y)
     float inc_x = x;
     float inc_y = y;
 
+#ifdef USE_ROTATION
     if (rctx.cur_obj.rot_cos != 1.f)
     {
         inc_x = -rctx.cur_obj.rot_sin*y + rctx.cur_obj.rot_cos*x;
         inc_y =  rctx.cur_obj.rot_cos*y + rctx.cur_obj.rot_sin*x;
     }
+#endif
 
     rctx.cur_obj.x += inc_x * global_scale;
     rctx.cur_obj.y += inc_y * global_scale;
@@ -876,9 +1396,11 @@ void g2dSetScaleWH(float w, float h)
     rctx.cur_obj.scale_w = w * global_scale;
     rctx.cur_obj.scale_h = h * global_scale;
 
+#ifdef USE_ROTATION
     // A trick to prevent an unexpected behavior when mirroring with GU_SPRITES.
     if (rctx.cur_obj.scale_w < 0 || rctx.cur_obj.scale_h < 0)
         rctx.use_rot = true;
+#endif
 }
 
 
@@ -887,8 +1409,10 @@ void g2dSetScaleRelative(float w, float h)
     rctx.cur_obj.scale_w *= w;
     rctx.cur_obj.scale_h *= h;
 
+#ifdef USE_ROTATION
     if (rctx.cur_obj.scale_w < 0 || rctx.cur_obj.scale_h < 0)
         rctx.use_rot = true;
+#endif
 }
 
 
@@ -897,8 +1421,10 @@ void g2dSetScaleWHRelative(float w, float h)
     rctx.cur_obj.scale_w += w * global_scale;
     rctx.cur_obj.scale_h += h * global_scale;
 
+#ifdef USE_ROTATION
     if (rctx.cur_obj.scale_w < 0 || rctx.cur_obj.scale_h < 0)
         rctx.use_rot = true;
+#endif
 }
 
 /* Color functions */
@@ -950,6 +1476,7 @@ void g2dSetAlphaRelative(int alpha)
 
 /* Rotation functions */
 
+#ifdef USE_ROTATION
 void g2dResetRotation()
 {
     rctx.cur_obj.rot = 0.f;
@@ -1006,6 +1533,7 @@ void g2dSetRotationRelative(float degrees)
 {
     g2dSetRotationRadRelative(degrees * M_PI_180);
 }
+#endif
 
 /* Crop functions */
 
@@ -1152,7 +1680,26 @@ void _swizzle(unsigned char *dest, unsigned char *source, int width, int height)
 }
 
 
-g2dTexture*g2dTexCreate(int w, int h)
+/* Mipmap levels a tw*th texture can have, each one is swizzled in whole
+ * 16 bytes * 8 rows blocks. */
+int _g2dTexMipLevels(int tw, int th)
+{
+    int levels = 1;
+
+    while (levels < MIP_MAX && (tw/2) * PIXEL_SIZE >= 16 && th/2 >= 8)
+    {
+        tw /= 2;
+        th /= 2;
+        levels++;
+    }
+
+    return levels;
+}
+
+
+/* Room for the mipmap levels is allocated along with the texture, so they
+ * don't need another copy of it later. */
+g2dTexture* _g2dTexCreate(int w, int h, bool mipmap)
 {
     g2dTexture *tex = malloc(sizeof(g2dTexture));
     if (tex == NULL)
@@ -1164,15 +1711,60 @@ g2dTexture*g2dTexCreate(int w, int h)
     tex->h = h;
     tex->ratio = (float)w / h;
     tex->swizzled = false;
+    tex->psm = GU_PSM_8888;
+    tex->vram = false;
+    tex->levels = (mipmap ? _g2dTexMipLevels(tex->tw, tex->th) : 1);
 
-    tex->data = malloc(tex->tw * tex->th * sizeof(g2dColor));
+    tex->data = malloc(_g2dTexLevelOffset(tex, tex->levels) * sizeof(g2dColor));
     if (tex->data == NULL)
     {
         free(tex);
         return NULL;
     }
 
-    memset(tex->data, 0, tex->tw * tex->th * sizeof(g2dColor));
+    memset(tex->data, 0, _g2dTexLevelOffset(tex, tex->levels) * sizeof(g2dColor));
+
+    return tex;
+}
+
+
+g2dTexture*g2dTexCreate(int w, int h)
+{
+    return _g2dTexCreate(w, h, false);
+}
+
+
+g2dTexture* g2dTexCreateTarget(int w, int h)
+{
+    if (!init)
+        g2dInit();
+    if (!init)
+        return NULL;
+
+    g2dTexture *tex = malloc(sizeof(g2dTexture));
+    if (tex == NULL)
+        return NULL;
+
+    tex->tw = _getNextPower2(w);
+    tex->th = _getNextPower2(h);
+    tex->w = w;
+    tex->h = h;
+    tex->ratio = (float)w / h;
+    tex->swizzled = false;
+    tex->psm = fb_psm;
+    tex->vram = true;
+    tex->levels = 1;
+
+    // Draw buffer width must be a multiple of 64 pixels
+    if (tex->tw < 64)
+        tex->tw = 64;
+
+    tex->data = valloc(tex->tw * tex->th * fb_pixel_size);
+    if (tex->data == NULL)
+    {
+        free(tex);
+        return NULL;
+    }
 
     return tex;
 }
@@ -1185,7 +1777,10 @@ void g2dTexFree(g2dTexture **tex)
     if (*tex == NULL)
         return;
 
-    free((*tex)->data);
+    if ((*tex)->vram)
+        vfree((*tex)->data);
+    else
+        free((*tex)->data);
     free((*tex));
 
     *tex = NULL;
@@ -1193,15 +1788,16 @@ void g2dTexFree(g2dTexture **tex)
 
 
 #ifdef USE_PNG
-g2dTexture* _g2dTexLoadPNG(FILE *fp)
+g2dTexture* _g2dTexLoadPNG(FILE *fp, bool swizzle, bool mipmap)
 {
     png_structp png_ptr;
     png_infop info_ptr;
     unsigned int sig_read = 0;
     png_uint_32 width, height;
     int bit_depth, color_type, interlace_type;
-    u32 x, y;
-    g2dColor *line;
+    u32 y, i;
+    u32 rowblocks, line_blocks;
+    u8 *line;
     g2dTexture *tex;
 
     png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
@@ -1222,17 +1818,47 @@ g2dTexture* _g2dTexLoadPNG(FILE *fp)
 
     png_set_filler(png_ptr, 0xff, PNG_FILLER_AFTER);
     
-    tex = g2dTexCreate(width, height);
-    line = malloc(width * 4);
+    tex = _g2dTexCreate(width, height, mipmap);
+    if (tex == NULL)
+    {
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return NULL;
+    }
+
+    // Swizzling is useless with small textures.
+    swizzle = swizzle && (width >= 16 || height >= 16) &&
+              (tex->tw * PIXEL_SIZE >= 16);
+
+    // Rows are decoded straight to their place, which saves a copy of the
+    // whole texture when swizzling. The line is padded to a whole block.
+    rowblocks = tex->tw * PIXEL_SIZE / 16;
+    line_blocks = (width * PIXEL_SIZE + 15) / 16;
+    line = calloc(line_blocks, 16);
+    if (line == NULL)
+    {
+        g2dTexFree(&tex);
+        png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+        return NULL;
+    }
 
     for (y = 0; y < height; y++)
     {
-        png_read_row(png_ptr, (u8*) line, NULL);
-        
-        for (x = 0; x < width; x++)
-            tex->data[x + y*tex->tw] = line[x];
+        png_read_row(png_ptr, line, NULL);
+
+        if (swizzle) // Blocks of 16 bytes * 8 rows
+        {
+            u8 *dest = (u8*)tex->data + (y >> 3) * rowblocks * 128 +
+                       (y & 0x7) * 16;
+
+            for (i = 0; i < line_blocks; i++)
+                memcpy(dest + i * 128, line + i * 16, 16);
+        }
+        else
+            memcpy(tex->data + y*tex->tw, line, width * PIXEL_SIZE);
     }
 
+    tex->swizzled = swizzle;
+
     free(line);
     png_read_end(png_ptr, info_ptr);
     png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
@@ -1314,6 +1940,91 @@ g2dTexture* _g2dTexLoadJPEG(FILE *fp)
 #endif
 
 
+/* Mipmaps */
+
+/* Index of texel (x,y) in a level lw texels wide, a swizzled block is
+ * 4 texels * 8 rows. */
+static inline int _g2dTexelIndex(int lw, int x, int y, bool swizzled)
+{
+    if (!swizzled)
+        return y*lw + x;
+
+    return ((y >> 3) * (lw >> 2) + (x >> 2)) * 32 + (y & 0x7) * 4 + (x & 0x3);
+}
+
+
+/* Fills the smaller levels after the texture's data, swizzled or not, each
+ * from the one above. Room for them is made if the texture was created
+ * without it. Texels are averaged weighted by their alpha, so transparent
+ * borders don't darken edges. */
+bool _g2dTexBuildMipmaps(g2dTexture *tex)
+{
+    int levels = tex->levels;
+    int lw = tex->tw, lh = tex->th;
+    bool sw = tex->swizzled;
+    int l, x, y;
+    g2dColor *src;
+
+    if (levels == 1)
+    {
+        g2dColor *data;
+
+        levels = _g2dTexMipLevels(tex->tw, tex->th);
+        if (levels == 1)
+            return true;
+
+        data = realloc(tex->data, _g2dTexLevelOffset(tex, levels) * PIXEL_SIZE);
+        if (data == NULL)
+            return false;
+
+        tex->data = data;
+        tex->levels = levels;
+    }
+
+    src = tex->data;
+
+    for (l=1; l<levels; l++)
+    {
+        g2dColor *dst = src + lw*lh;
+
+        for (y=0; y<lh/2; y++)
+        {
+            for (x=0; x<lw/2; x++)
+            {
+                g2dColor c[4] =
+                {
+                    src[_g2dTexelIndex(lw, 2*x,   2*y,   sw)],
+                    src[_g2dTexelIndex(lw, 2*x+1, 2*y,   sw)],
+                    src[_g2dTexelIndex(lw, 2*x,   2*y+1, sw)],
+                    src[_g2dTexelIndex(lw, 2*x+1, 2*y+1, sw)]
+                };
+                unsigned int r = 0, g = 0, b = 0, a = 0;
+                int i;
+
+                for (i=0; i<4; i++)
+                {
+                    unsigned int ca = G2D_GET_A(c[i]);
+
+                    r += G2D_GET_R(c[i]) * ca;
+                    g += G2D_GET_G(c[i]) * ca;
+                    b += G2D_GET_B(c[i]) * ca;
+                    a += ca;
+                }
+
+                dst[_g2dTexelIndex(lw/2, x, y, sw)] =
+                    (a == 0 ? 0 : G2D_RGBA(r/a, g/a, b/a, a/4));
+            }
+        }
+
+        src = dst;
+        lw /= 2;
+        lh /= 2;
+    }
+
+    return true;
+}
+
+
 g2dTexture* g2dTexLoad(char path[], g2dTex_Mode mode)
 {
     g2dTexture *tex = NULL;
@@ -1327,7 +2038,8 @@ g2dTexture* g2dTexLoad(char path[], g2dTex_Mode mode)
 #ifdef USE_PNG
     if (strstr(path, ".png"))
     {
-        tex = _g2dTexLoadPNG(fp);
+        // Decoded straight to swizzled rows, levels are built from those
+        tex = _g2dTexLoadPNG(fp, mode & G2D_SWIZZLE, mode & G2D_MIPMAP);
     }
 #endif
 
@@ -1348,19 +2060,34 @@ g2dTexture* g2dTexLoad(char path[], g2dTex_Mode mode)
     if (tex->w > 512 || tex->h > 512)
         goto error;
 
+    if ((mode & G2D_MIPMAP) && !_g2dTexBuildMipmaps(tex))
+        goto error;
+
     // Swizzling is useless with small textures.
-    if ((mode & G2D_SWIZZLE) && (tex->w >= 16 || tex->h >= 16))
+    // PNGs are already decoded swizzled.
+    if (!tex->swizzled && (mode & G2D_SWIZZLE) &&
+        (tex->w >= 16 || tex->h >= 16))
     {
-        u8 *tmp = malloc(tex->tw*tex->th*PIXEL_SIZE);
-        _swizzle(tmp, (u8*)tex->data, tex->tw*PIXEL_SIZE, tex->th);
+        int l;
+        u8 *tmp = malloc(_g2dTexLevelOffset(tex, tex->levels)*PIXEL_SIZE);
+        if (tmp == NULL)
+            goto error;
+
+        for (l=0; l<tex->levels; l++)
+        {
+            int offset = _g2dTexLevelOffset(tex, l)*PIXEL_SIZE;
+
+            _swizzle(tmp + offset, (u8*)tex->data + offset,
+                     (tex->tw >> l)*PIXEL_SIZE, tex->th >> l);
+        }
+
         free(tex->data);
         tex->data = (g2dColor*)tmp;
         tex->swizzled = true;
     }
-    else
-        tex->swizzled = false;
 
-    sceKernelDcacheWritebackRange(tex->data, tex->tw*tex->th*PIXEL_SIZE);
+    sceKernelDcacheWritebackRange(tex->data,
+                                  _g2dTexLevelOffset(tex, tex->levels)*PIXEL_SIZE);
 
     return tex;
 
@@ -1374,6 +2101,31 @@ error:
     return NULL;
 }
 
+/* Render target functions */
+
+void g2dSetRenderTarget(g2dTexture *tex)
+{
+    if (!start)
+        _g2dStart();
+
+    if (tex == target)
+        return;
+
+    if (tex != NULL)
+    {
+        sceGuDrawBufferList(tex->psm, vrelptr(tex->data), tex->tw);
+        sceGuOffset(2048-tex->w/2, 2048-tex->h/2);
+        sceGuViewport(2048, 2048, tex->w, tex->h);
+        g2dSetScissor(0, 0, tex->w, tex->h);
+    }
+    else
+    {
+        _g2dTargetScreen();
+    }
+
+    target = tex;
+}
+
 /* Scissor functions */
 
 void g2dResetScissor()
@@ -79,9 +79,48 @@ extern "C" {
  * Enable this to greatly improve performance with 2d rotations. You SHOULD use
  * PSP_MAIN_THREAD_ATTR(THREAD_ATTR_USER | THREAD_ATTR_VFPU) to avoid crashes.
  */
+/**
+ * \def USE_STATS
+ * \brief Choose if the frame statistics are collected.
+ *
+ * Otherwise, this part will be not compiled to avoid the timing syscalls.
+ * Enable this to read per-frame timings with g2dGetStats().
+ */
+/**
+ * \def USE_LINES
+ * \brief Choose if g2dBeginLines() is available.
+ */
+/**
+ * \def USE_QUADS
+ * \brief Choose if g2dBeginQuads() is available.
+ */
+/**
+ * \def USE_POINTS
+ * \brief Choose if g2dBeginPoints() is available.
+ */
+/**
+ * \def USE_ROTATION
+ * \brief Choose if objects can be rotated or mirrored.
+ *
+ * Otherwise, the g2dSetRotation*() functions are not compiled and rects are
+ * always drawn as sprites. Negative scales need it (drawn as two triangles).
+ */
+/**
+ * \def USE_TRANSFORM
+ * \brief Choose if the g2dPush() / g2dPop() transformation stack is enabled.
+ *
+ * Primitives and features left out are not compiled, the remaining paths
+ * don't check for them at runtime.
+ */
 #define USE_PNG
 // #define USE_JPEG
 #define USE_VFPU
+// #define USE_STATS
+// #define USE_LINES
+// #define USE_QUADS
+// #define USE_POINTS
+// #define USE_ROTATION
+// #define USE_TRANSFORM
 
 /**
  * \def G2D_SCR_W
@@ -201,6 +240,13 @@ enum g2dColors
  * Change texture properties.
  * Can only be used with g2dTexLoad.
  */
+/**
+ * \enum g2dInit_Mode
+ * \brief Init modes enumeration.
+ *
+ * Choose the framebuffer pixel format, G2D_NO_DEPTH can be or'ed with it.
+ * Can only be used with g2dInitMode.
+ */
 typedef enum
 {
     G2D_UP_LEFT,
@@ -220,8 +266,19 @@ typedef enum
 } g2dFlip_Mode;
 typedef enum
 {
-    G2D_SWIZZLE = 1 /**< Recommended. Use it to speedup rendering. */
+    G2D_SWIZZLE = 1, /**< Recommended. Use it to speedup rendering. */
+    G2D_MIPMAP = 2   /**< Build smaller levels, for textures drawn scaled down. */
 } g2dTex_Mode;
+typedef enum
+{
+    G2D_PSM_8888 = 0, /**< 32 bits framebuffers (default). */
+    G2D_PSM_5650 = 1, /**< 16 bits framebuffers, no alpha. Halves the
+                           bandwidth of clears and blending. */
+    G2D_PSM_5551 = 2, /**< 16 bits framebuffers, 1 bit alpha. */
+    G2D_NO_DEPTH = 4  /**< No depth buffer, for 2D only apps. The z
+                           coordinate is ignored, and the VRAM is left free
+                           for valloc(). */
+} g2dInit_Mode;
 
 /**
  * \var g2dAlpha
@@ -247,27 +304,72 @@ typedef struct
     float ratio;        /**< Width/height ratio. */
     bool swizzled;      /**< Is the texture swizzled ? */
     g2dColor *data;     /**< Pointer to raw data. */
+    int psm;            /**< Pixel format (GU_PSM_*). */
+    bool vram;          /**< Is the data in VRAM ? */
+    int levels;         /**< Mipmap levels, 1 without. Each one follows the
+                             previous one in data, half its size. */
 } g2dTexture;
 
 /**
  * \var g2d_draw_buffer
  * \brief The current draw buffer as a texture.
+ *
+ * Pixels are 16 bits wide when initialized with G2D_PSM_5650 or G2D_PSM_5551.
  */
 /**
  * \var g2d_disp_buffer
  * \brief The current display buffer as a texture.
+ *
+ * Pixels are 16 bits wide when initialized with G2D_PSM_5650 or G2D_PSM_5551.
  */
 extern g2dTexture g2d_draw_buffer;
 extern g2dTexture g2d_disp_buffer;
 
+/**
+ * \struct g2dStats
+ * \brief Frame statistics structure.
+ *
+ * Filled by g2dGetStats(), only when USE_STATS is defined.
+ * Times are in microseconds and describe the last flipped frame.
+ */
+typedef struct
+{
+    unsigned int frame;     /**< Number of flipped frames. */
+    unsigned int cpu_time;  /**< Time spent building the display list. */
+    unsigned int ge_wait;   /**< Time spent waiting for the previous list. */
+    unsigned int flip_time; /**< Time between the last two flips. */
+    unsigned int state_sent;    /**< GE state changes sent. */
+    unsigned int state_skipped; /**< GE state changes already set. */
+    unsigned int vertices;  /**< Vertices sent to the GE. */
+    unsigned int fill;      /**< Pixels covered by rectangles. */
+    unsigned int tex_bytes; /**< Texture bytes covered by sampled levels. */
+} g2dStats;
+
 /**
  * \brief Initializes the library.
  *
  * This function will create a GU context and setup the display buffers.
  * Automatically called by the other functions.
+ * Same as g2dInitMode(G2D_PSM_8888).
  */
 void g2dInit();
 
+/**
+ * \brief Initializes the library with a framebuffer pixel format.
+ * @param mode Framebuffer pixel format, and G2D_NO_DEPTH.
+ * @returns 0 on success, -1 if the buffers couldn't be allocated.
+ *
+ * 16 bits framebuffers use half the VRAM and halve the bandwidth of
+ * g2dClear() and of every blended pixel, at the cost of color precision.
+ * Textures are still 32 bits. Does nothing if the library is already
+ * initialized.
+ *
+ * Buffers are allocated with valloc(), so vmemavail() tells how much VRAM
+ * is left for the application. Nothing stays allocated if it fails, and
+ * the library stays uninitialized.
+ */
+int g2dInitMode(g2dInit_Mode mode);
+
 /**
  * \brief Shutdowns the library.
  *
@@ -289,6 +391,7 @@ void g2dClear(g2dColor color);
  *
  * This function clears the zbuffer to zero (z range 0-65535).
  * Will automatically init the GU if needed.
+ * Does nothing when initialized with G2D_NO_DEPTH.
  */
 void g2dClearZ();
 
@@ -304,6 +407,7 @@ void g2dClearZ();
  */
 void g2dBeginRects(g2dTexture *tex);
 
+#ifdef USE_LINES
 /**
  * \brief Begins lines rendering.
  * @param line_mode A g2dLine_Mode constant.
@@ -313,7 +417,9 @@ void g2dBeginRects(g2dTexture *tex);
  * Pass G2D_LINE_STRIP to make a line strip (two calls, then one per object).
  */
 void g2dBeginLines(g2dLine_Mode mode);
+#endif
 
+#ifdef USE_QUADS
 /**
  * \brief Begins quads rendering.
  * @param tex Pointer to a texture, pass NULL to get a colored quad.
@@ -325,7 +431,9 @@ void g2dBeginLines(g2dLine_Mode mode);
  * to render multiple textures.
  */
 void g2dBeginQuads(g2dTexture *tex);
+#endif
 
+#ifdef USE_POINTS
 /**
  * \brief Begins points rendering.
  *
@@ -333,13 +441,15 @@ void g2dBeginQuads(g2dTexture *tex);
  * One g2dAdd() call per object.
  */
 void g2dBeginPoints();
+#endif
 
 /**
  * \brief Ends object rendering.
  *
  * This function ends object rendering. Must be called after g2dBegin*() to add
  * objects to the display list. Automatically adapts pspgu functionnalities
- * to get the best performance possible.
+ * to get the best performance possible. GE states which didn't change since
+ * the previous g2dEnd() are not sent again.
  */
 void g2dEnd();
 
@@ -357,11 +467,21 @@ void g2dReset();
  * @param flip_mode A g2dFlip_Mode constant.
  *
  * This function must be called at the end of the loop.
- * Renders the whole display list to the draw buffer.
- * Inverts framebuffers to display the whole thing.
+ * Sends the display list to the GE without waiting for it, then displays
+ * the previous frame once its list is drawn. Two display lists are used in
+ * turn, so the next frame is built while the GE renders this one.
  */
 void g2dFlip(g2dFlip_Mode mode);
 
+/**
+ * \brief Gets the frame statistics.
+ * @param stats Pointer to save the statistics.
+ *
+ * The CPU builds a frame while the GE draws the previous one, so the overlap
+ * is cpu_time - ge_wait. Does nothing if USE_STATS is not defined.
+ */
+void g2dGetStats(g2dStats *stats);
+
 /**
  * \brief Pushes the current transformation & attribution to a new object.
  *
@@ -369,6 +489,7 @@ void g2dFlip(g2dFlip_Mode mode);
  */
 void g2dAdd();
 
+#ifdef USE_TRANSFORM
 /**
  * \brief Saves the current transformation to stack.
  *
@@ -386,6 +507,7 @@ void g2dPush();
  * Use it like the OpenGL one.
  */
 void g2dPop();
+#endif
 
 /**
  * \brief Creates a new blank texture.
@@ -396,6 +518,17 @@ void g2dPop();
  */
 g2dTexture* g2dTexCreate(int w, int h);
 
+/**
+ * \brief Creates a new blank texture that can be rendered to.
+ * @param w Width of the texture.
+ * @param h Height of the texture.
+ *
+ * The texture is in VRAM, with the framebuffer pixel format.
+ * Use it with g2dSetRenderTarget(). This function returns NULL on allocation
+ * fail (eg.: not enough VRAM, see G2D_NO_DEPTH).
+ */
+g2dTexture* g2dTexCreateTarget(int w, int h);
+
 /**
  * \brief Frees a texture & set its pointer to NULL.
  * @param tex Pointer to the variable which contains the texture pointer.
@@ -415,6 +548,8 @@ void g2dTexFree(g2dTexture **tex);
  * This function loads an image file. There is support for PNG & JPEG files
  * (if USE_PNG and USE_JPEG are defined). Swizzling is enabled only for 16*16+
  * textures (useless on small textures), pass G2D_SWIZZLE to enable it.
+ * Pass G2D_MIPMAP to also build smaller levels (a third more memory), the one
+ * used is picked from the size objects are drawn at, by g2dEnd().
  * Texture supported up to 512*512 in size only (hardware limitation).
  */
 g2dTexture* g2dTexLoad(char path[], g2dTex_Mode mode);
@@ -632,6 +767,7 @@ void g2dSetAlpha(g2dAlpha alpha);
  */
 void g2dSetAlphaRelative(int alpha);
 
+#ifdef USE_ROTATION
 /**
  * \brief Resets the current rotation.
  *
@@ -693,6 +829,7 @@ void g2dSetRotationRadRelative(float radians);
  * The rotation center is the actual coordinates.
  */
 void g2dSetRotationRelative(float degrees);
+#endif
 
 /**
  * \brief Resets the current crop.
@@ -791,6 +928,16 @@ void g2dSetTexRepeat(bool use);
  */
 void g2dSetTexLinear(bool use);
 
+/**
+ * \brief Renders to a texture instead of the screen.
+ * @param tex Texture created by g2dTexCreateTarget(), NULL for the screen.
+ *
+ * This function must be called outside object rendering.
+ * Coordinates and the scissor become relative to the texture, g2dClear()
+ * only clears the texture. Resets to the screen on every frame.
+ */
+void g2dSetRenderTarget(g2dTexture *tex);
+
 /**
  * \brief Resets the draw zone to the entire screen.
  *
@@ -0,0 +1,297 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pspkernel.h>
+#include <pspiofilemgr.h>
+#include <pspaudio.h>
+#include <psprtc.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "clocktime.h"
+#include "music.h"
+
+alarm_config alarm_cfg = {0};
+
+// Minute of the week (0 is Sunday 00:00) the next alarm rings at, -1 if none
+static int alarm_next = -1;
+static int alarm_last_minute = -1;
+static int alarm_day_of_week = -1;
+
+static cbool alarm_ring = FALSE;
+static SceInt64 alarm_ring_start = 0;
+static cbool alarm_use_music = FALSE;
+static cbool alarm_music_started = FALSE;
+
+static short alarm_tone_buf[ALARM_TONE_SAMPLES] __attribute__((aligned(64)));
+static int alarm_tone_ch = -1;
+static cbool alarm_tone_on = FALSE;
+
+/* Fills cfg from the contents of ALARM_FILE
+ * Lines that aren't an alarm are ignored (eg.: comments)
+ */
+int alarm_parse(alarm_config* cfg, const char* text)
+{
+  if (!cfg || !text) return -1;
+
+  cfg->count = 0;
+
+  while ( *text && cfg->count < ALARM_MAX )
+  {
+    const char* end = strchr(text, '\n');
+    size_t len = end ? (size_t)(end - text) : strlen(text);
+
+    char line[32];
+    if (len >= sizeof(line)) len = sizeof(line) - 1;
+    memcpy(line, text, len);
+    line[len] = '\0';
+
+    uint hour, minute;
+    char days[8] = {0};
+    int n = sscanf(line, "%u:%u %7s", &hour, &minute, days);
+
+    if ( n >= 2 && hour < 24 && minute < 60 )
+    {
+      alarm_entry* e = &cfg->list[cfg->count++];
+
+      e->hour = hour;
+      e->minute = minute;
+      e->days = 0x7F;
+      e->enabled = TRUE;
+
+      if ( n == 3 )
+      {
+        e->days = 0;
+
+        for ( int day = 0; day < 7 && days[day]; day++ )
+        {
+          if (days[day] != '-') e->days |= 1 << day;
+        }
+      }
+    }
+
+    if (!end) break;
+    text = end + 1;
+  }
+
+  return cfg->count;
+}
+
+// Minute of the week of the first alarm at or after now, -1 if there's none
+int alarm_next_minute(const alarm_config* cfg, int now)
+{
+  int next = -1;
+  int next_delta = ALARM_WEEK_MINUTES;
+
+  for ( int i = 0; i < cfg->count; i++ )
+  {
+    const alarm_entry* e = &cfg->list[i];
+    if (!e->enabled) continue;
+
+    for ( int day = 0; day < 7; day++ )
+    {
+      if ( !(e->days & (1 << day)) ) continue;
+
+      int minute = day * ALARM_DAY_MINUTES + e->hour * 60 + e->minute;
+      int delta = (minute - now + ALARM_WEEK_MINUTES) % ALARM_WEEK_MINUTES;
+
+      if ( delta < next_delta )
+      {
+        next_delta = delta;
+        next = minute;
+      }
+    }
+  }
+
+  return next;
+}
+
+static int alarm_load(const char* path)
+{
+  SceUID fd = sceIoOpen(path, PSP_O_RDONLY, 0777);
+  if (fd < 0) return -1;
+
+  // A few lines at most, read in one go
+  char text[ALARM_MAX * 32];
+  int read = sceIoRead(fd, text, sizeof(text) - 1);
+  sceIoClose(fd);
+
+  if (read < 0) return -1;
+  text[read] = '\0';
+
+  return alarm_parse(&alarm_cfg, text);
+}
+
+// Not fatal, there are simply no alarms if this fails
+int alarm_init(cbool use_music)
+{
+  alarm_use_music = use_music;
+  alarm_cfg.armed = alarm_load(ALARM_FILE) > 0;
+
+  return alarm_cfg.count > 0 ? 0 : -1;
+}
+
+static void alarm_tone_start(void)
+{
+  if ( alarm_tone_ch < 0 )
+  {
+    // Beep for the first half, then silence, square wave is good enough
+    const uint half_period = 44100 / ALARM_TONE_HZ / 2;
+
+    for ( uint i = 0; i < ALARM_TONE_SAMPLES; i++ )
+    {
+      if (i >= ALARM_TONE_SAMPLES / 2) alarm_tone_buf[i] = 0;
+      else alarm_tone_buf[i] = ((i / half_period) & 1) ? -ALARM_TONE_AMP : ALARM_TONE_AMP;
+    }
+
+    alarm_tone_ch = sceAudioChReserve(PSP_AUDIO_NEXT_CHANNEL, ALARM_TONE_SAMPLES, PSP_AUDIO_FORMAT_MONO);
+  }
+
+  alarm_tone_on = alarm_tone_ch >= 0;
+}
+
+// Queues the next beep once the last one is done, never blocks
+static void alarm_tone_feed(void)
+{
+  if ( alarm_tone_on && sceAudioGetChannelRestLen(alarm_tone_ch) <= 0 )
+  {
+    sceAudioOutput(alarm_tone_ch, PSP_AUDIO_VOLUME_MAX, alarm_tone_buf);
+  }
+}
+
+void alarm_end(void)
+{
+  alarm_tone_on = FALSE;
+
+  if (alarm_tone_ch < 0) return;
+
+  // A channel can't be released while it's still playing
+  while ( sceAudioGetChannelRestLen(alarm_tone_ch) > 0 ) sceKernelDelayThread(10000);
+
+  sceAudioChRelease(alarm_tone_ch);
+  alarm_tone_ch = -1;
+}
+
+void alarm_set_armed(cbool armed)
+{
+  alarm_cfg.armed = armed;
+  if (!armed && alarm_ring) alarm_dismiss();
+}
+
+cbool alarm_armed(void)
+{
+  return alarm_cfg.armed && alarm_next >= 0;
+}
+
+cbool alarm_ringing(void)
+{
+  return alarm_ring;
+}
+
+static void alarm_ring_begin(void)
+{
+  alarm_ring = TRUE;
+  alarm_ring_start = sceKernelGetSystemTimeWide();
+  alarm_music_started = FALSE;
+
+  if ( alarm_use_music )
+  {
+    // Already playing is as good as ringing
+    if ( !music_enabled() ) alarm_music_started = music_cmd_send(MUSIC_CMD_PLAY, 0);
+  }
+  else
+  {
+    alarm_tone_start();
+  }
+}
+
+void alarm_dismiss(void)
+{
+  if (!alarm_ring) return;
+
+  alarm_ring = FALSE;
+  alarm_tone_on = FALSE;
+
+  // Leave music alone if it was already on
+  if ( alarm_music_started && music_enabled() ) music_cmd_send(MUSIC_CMD_STOP, 0);
+  alarm_music_started = FALSE;
+}
+
+/* Checks for alarms once a minute, the next one is kept around so this is O(1)
+ * changes are the CLOCK_TIME_* from clock_time_update(), returns TRUE if it started / stopped ringing
+ */
+cbool alarm_update(const ScePspDateTime* now, int changes)
+{
+  cbool changed = FALSE;
+
+  if ( alarm_ring )
+  {
+    alarm_tone_feed();
+
+    if ( sceKernelGetSystemTimeWide() - alarm_ring_start >= ALARM_RING_TIME )
+    {
+      alarm_dismiss();
+      changed = TRUE;
+    }
+  }
+
+  if ( alarm_last_minute >= 0 && !(changes & (CLOCK_TIME_MINUTE | CLOCK_TIME_HOUR | CLOCK_TIME_DAY)) ) return changed;
+
+  if ( alarm_day_of_week < 0 || (changes & CLOCK_TIME_DAY) )
+  {
+    alarm_day_of_week = sceRtcGetDayOfWeek(now->year, now->month, now->day);
+  }
+
+  int minute = alarm_day_of_week * ALARM_DAY_MINUTES + now->hour * 60 + now->minute;
+
+  // Time jumped (slept, time was changed), start over from now
+  if ( alarm_last_minute < 0 || minute != (alarm_last_minute + 1) % ALARM_WEEK_MINUTES )
+  {
+    alarm_next = alarm_next_minute(&alarm_cfg, minute);
+  }
+
+  alarm_last_minute = minute;
+
+  if ( alarm_next != minute ) return changed;
+
+  alarm_next = alarm_next_minute(&alarm_cfg, (minute + 1) % ALARM_WEEK_MINUTES);
+
+  if ( !alarm_cfg.armed || alarm_ring ) return changed;
+
+  alarm_ring_begin();
+  return TRUE;
+}
+
+// How long (in us) until the next alarm rings, ALARM_NONE if none will
+uint alarm_time_until(const ScePspDateTime* now)
+{
+  if ( !alarm_armed() || alarm_last_minute < 0 ) return ALARM_NONE;
+
+  int minutes = (alarm_next - alarm_last_minute + ALARM_WEEK_MINUTES) % ALARM_WEEK_MINUTES;
+
+  // alarm_update() has already moved past an alarm at this minute, so it's the same one next week
+  if (minutes == 0) minutes = ALARM_WEEK_MINUTES;
+  SceInt64 us = minutes * 60LL * 1000000 - now->second * 1000000LL - now->microsecond;
+
+  if (us <= 0) return 0;
+  if (us >= ALARM_NONE) return ALARM_NONE;
+
+  return (uint)us;
+}
@@ -0,0 +1,74 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ALARM_H_
+#define ALARM_H_
+
+#include <psprtc.h>
+
+#include "utils.h"
+
+#define ALARM_MAX 8
+
+// Read at startup, one alarm per line: "HH:MM" (every day) or "HH:MM SMTWTFS" ('-' skips that day)
+#define ALARM_FILE "alarms.txt"
+
+// Rings for this long (in us) if nobody dismisses it
+#define ALARM_RING_TIME (5LL * 60 * 1000 * 1000)
+
+// Tone used when there's no music to play, must be a multiple of 64 samples (44100 Hz)
+#define ALARM_TONE_SAMPLES 22016
+#define ALARM_TONE_HZ 880
+#define ALARM_TONE_AMP 0x2000
+
+#define ALARM_DAY_MINUTES (24 * 60)
+#define ALARM_WEEK_MINUTES (7 * ALARM_DAY_MINUTES)
+
+// alarm_time_until() when no alarm is coming
+#define ALARM_NONE 0xFFFFFFFF
+
+typedef struct
+{
+  uchar hour;
+  uchar minute;
+  uchar days; // 1 << day of week (0 is Sunday)
+  cbool enabled;
+} alarm_entry;
+
+typedef struct
+{
+  alarm_entry list[ALARM_MAX];
+  uchar count;
+  cbool armed;
+} alarm_config;
+
+extern alarm_config alarm_cfg;
+
+int alarm_init(cbool use_music);
+void alarm_end(void);
+int alarm_parse(alarm_config* cfg, const char* text);
+int alarm_next_minute(const alarm_config* cfg, int now);
+void alarm_set_armed(cbool armed);
+cbool alarm_armed(void);
+cbool alarm_ringing(void);
+void alarm_dismiss(void);
+cbool alarm_update(const ScePspDateTime* now, int changes);
+uint alarm_time_until(const ScePspDateTime* now);
+
+#endif /* ALARM_H_ */
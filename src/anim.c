@@ -0,0 +1,110 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pspkernel.h>
+
+#include "anim.h"
+
+float anim_ease_lut[ANIM_EASE_COUNT][ANIM_EASE_STEPS + 1];
+
+// Until when main() has to keep drawing every frame
+static uint anim_until = 0;
+static cbool anim_requested = FALSE;
+
+// Samples every curve once, so animating never has to evaluate them
+void anim_init(void)
+{
+  for (int step = 0; step <= ANIM_EASE_STEPS; step++)
+  {
+    float t = (float)step / ANIM_EASE_STEPS;
+    float inv = 1.0f - t;
+
+    anim_ease_lut[ANIM_EASE_LINEAR][step] = t;
+    anim_ease_lut[ANIM_EASE_IN][step] = t * t * t;
+    anim_ease_lut[ANIM_EASE_OUT][step] = 1.0f - inv * inv * inv;
+    anim_ease_lut[ANIM_EASE_IN_OUT][step] = t * t * (3.0f - 2.0f * t);
+  }
+}
+
+// t from 0 to 1, interpolated between the 2 closest samples
+float anim_ease(int ease, float t)
+{
+  if (ease < 0 || ease >= ANIM_EASE_COUNT) ease = ANIM_EASE_LINEAR;
+  if (t <= 0.0f) return 0.0f;
+  if (t >= 1.0f) return 1.0f;
+
+  float pos = t * ANIM_EASE_STEPS;
+  int step = (int)pos;
+  float frac = pos - step;
+
+  const float* lut = anim_ease_lut[ease];
+  return lut[step] + (lut[step + 1] - lut[step]) * frac;
+}
+
+// Holds the first / last key's value before / after them
+float anim_track_value(const anim_track* track, uint time)
+{
+  if ( !track || track->count <= 0 ) return 0.0f;
+
+  const anim_key* keys = track->keys;
+
+  if (time <= keys[0].time) return keys[0].value;
+
+  for (int key = 1; key < track->count; key++)
+  {
+    if (time >= keys[key].time) continue;
+
+    const anim_key* a = &keys[key - 1];
+    const anim_key* b = &keys[key];
+    float t = (float)(time - a->time) / (float)(b->time - a->time);
+
+    return a->value + (b->value - a->value) * anim_ease(b->ease, t);
+  }
+
+  return keys[track->count - 1].value;
+}
+
+// In ms
+uint anim_track_length(const anim_track* track)
+{
+  if ( !track || track->count <= 0 ) return 0;
+
+  return track->keys[track->count - 1].time;
+}
+
+/* Something will be animating for duration (in ms) from now on,
+ * main() draws every frame until then, then goes back to sleeping between changes
+ */
+void anim_request(uint duration)
+{
+  uint until = sceKernelGetSystemTimeLow() + duration * 1000;
+
+  if ( !anim_requested || (int)(until - anim_until) > 0 ) anim_until = until;
+  anim_requested = TRUE;
+}
+
+cbool anim_active(void)
+{
+  if (!anim_requested) return FALSE;
+
+  // Dropped once it's over, so the timer wrapping around doesn't bring it back
+  if ( (int)(anim_until - sceKernelGetSystemTimeLow()) <= 0 ) anim_requested = FALSE;
+
+  return anim_requested;
+}
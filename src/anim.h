@@ -0,0 +1,63 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ANIM_H_
+#define ANIM_H_
+
+#include "utils.h"
+
+// Easing curves are sampled this many times (plus the end) by anim_init()
+#define ANIM_EASE_STEPS 64
+
+enum
+{
+  ANIM_EASE_LINEAR,
+  ANIM_EASE_IN,      // Cubic, starts slow
+  ANIM_EASE_OUT,     // Cubic, ends slow
+  ANIM_EASE_IN_OUT,  // Smoothstep
+
+  ANIM_EASE_COUNT
+};
+
+// Value reached at time (ms since the track started), eased from the previous key
+typedef struct
+{
+  uint time;
+  float value;
+  uchar ease;
+} anim_key;
+
+typedef struct
+{
+  const anim_key* keys;
+  int count;
+} anim_track;
+
+#define ANIM_TRACK(keys) { (keys), ARRAY_SIZE(keys) }
+
+extern float anim_ease_lut[ANIM_EASE_COUNT][ANIM_EASE_STEPS + 1];
+
+void anim_init(void);
+float anim_ease(int ease, float t);
+float anim_track_value(const anim_track* track, uint time);
+uint anim_track_length(const anim_track* track);
+void anim_request(uint duration);
+cbool anim_active(void);
+
+#endif /* ANIM_H_ */
@@ -17,15 +17,14 @@
  *  along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <pspkernel.h>
 #include <psppower.h>
 
 #include "battery.h"
 #include "tex.h"
 
-bat_status bat_get_status()
+bat_status bat_get_status_by_perc(bat_perc perc)
 {
-  bat_perc perc = scePowerGetBatteryLifePercent();
-  
   if (perc >= 80)
     return BAT_STATUS_FULL;
 
@@ -41,9 +40,37 @@ bat_status bat_get_status()
   return BAT_STATUS_EMPTY;
 }
 
-void get_tex_by_curr_bat_status(app_tex** out)
+bat_status bat_get_status()
 {
-  switch(bat_get_status())
+  return bat_get_status_by_perc(scePowerGetBatteryLifePercent());
+}
+
+/* Only changes bars once perc is BAT_HYSTERESIS past a threshold,
+ * so the icon doesn't flicker when perc goes back and forth around it
+ */
+bat_status bat_get_status_hysteresis(bat_perc perc, bat_status curr)
+{
+  bat_status status = bat_get_status_by_perc(perc);
+
+  // Going up (fewer is more bars)
+  if (status < curr)
+  {
+    status = bat_get_status_by_perc(perc - BAT_HYSTERESIS);
+    if (status > curr) status = curr;
+  }
+  // Going down
+  else if (status > curr)
+  {
+    status = bat_get_status_by_perc(perc + BAT_HYSTERESIS);
+    if (status < curr) status = curr;
+  }
+
+  return status;
+}
+
+void get_tex_by_bat_status(bat_status status, app_tex** out)
+{
+  switch(status)
     {
       case BAT_STATUS_FULL:
         *out = &main_clock_tex.s.bat_full;
@@ -66,4 +93,55 @@ void get_tex_by_curr_bat_status(app_tex** out)
         *out = &main_clock_tex.s.bat_empty;
         break;
     }
-}
\ No newline at end of file
+}
+
+void get_tex_by_curr_bat_status(app_tex** out)
+{
+  get_tex_by_bat_status(bat_get_status(), out);
+}
+
+static bat_monitor bat_mon = { .status = BAT_STATUS_UNKNOWN, .interval = BAT_SAMPLE_INTERVAL };
+
+void bat_monitor_init(uint interval)
+{
+  bat_mon.interval = interval;
+  bat_mon.status = BAT_STATUS_UNKNOWN;
+}
+
+// Next bat_monitor_update() will sample the battery (eg.: on power events)
+void bat_monitor_invalidate(void)
+{
+  bat_mon.stale = TRUE;
+}
+
+/* Samples the battery every bat_mon.interval us, instead of every frame
+ * out is always set, returns TRUE only if the icon has changed
+ */
+cbool bat_monitor_update(app_tex** out)
+{
+  uint now = sceKernelGetSystemTimeLow();
+  bat_status status = bat_mon.status;
+
+  if ( status == BAT_STATUS_UNKNOWN )
+  {
+    status = bat_get_status();
+  }
+  else if ( bat_mon.stale || now - bat_mon.last_sample >= bat_mon.interval )
+  {
+    status = bat_get_status_hysteresis(scePowerGetBatteryLifePercent(), status);
+  }
+  else
+  {
+    get_tex_by_bat_status(status, out);
+    return FALSE;
+  }
+
+  bat_mon.last_sample = now;
+  bat_mon.stale = FALSE;
+
+  cbool changed = status != bat_mon.status;
+  bat_mon.status = status;
+
+  get_tex_by_bat_status(status, out);
+  return changed;
+}
@@ -23,6 +23,15 @@
 #include "utils.h"
 #include "tex.h"
 
+// Battery is sampled every 10 seconds
+#define BAT_SAMPLE_INTERVAL (10 * 1000 * 1000)
+
+// Or every minute, when power events tell us about changes
+#define BAT_SAMPLE_INTERVAL_EVENTS (60 * 1000 * 1000)
+
+// Percentage past a threshold needed to change bars
+#define BAT_HYSTERESIS 2
+
 typedef int bat_perc;
 typedef uchar bat_status;
 
@@ -33,9 +42,26 @@ enum
     BAT_STATUS_2BARS,
     BAT_STATUS_1BARS,
     BAT_STATUS_EMPTY,
+
+    BAT_STATUS_UNKNOWN,
 };
 
+typedef struct
+{
+    bat_status status;
+    cbool stale;
+    uint interval; // us
+    uint last_sample;
+} bat_monitor;
+
 bat_status bat_get_status();
+bat_status bat_get_status_by_perc(bat_perc perc);
+bat_status bat_get_status_hysteresis(bat_perc perc, bat_status curr);
+void get_tex_by_bat_status(bat_status status, app_tex** out);
 void get_tex_by_curr_bat_status(app_tex** out);
 
+void bat_monitor_init(uint interval);
+void bat_monitor_invalidate(void);
+cbool bat_monitor_update(app_tex** out);
+
 #endif /* BATTERY_H_ */
\ No newline at end of file
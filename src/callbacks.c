@@ -18,9 +18,23 @@
  */
 
 #include <pspkernel.h>
+#include <psppower.h>
 
 #include "utils.h"
 #include "main.h"
+#include "ring.h"
+#include "input.h"
+#include "callbacks.h"
+
+cbool power_callback_registered = FALSE;
+
+static power_event power_events_buf[POWER_EVENT_QUEUE_SIZE];
+static spsc_ring power_events;
+static volatile int power_last_flags = -1;
+
+// Each side only writes its own count, so a drop is never lost between reading and clearing
+static volatile uint power_events_dropped = 0;
+static uint power_events_caught_up = 0;
 
 // Will execute when user tries to exit app
 static int exit_callback(int arg1, int arg2, void *common)
@@ -33,6 +47,63 @@ static int exit_callback(int arg1, int arg2, void *common)
   return 0;
 }
 
+static void power_event_push(uchar type, int flags)
+{
+  power_event ev = { .type = type, .flags = flags };
+
+  // A full queue drops the newest event, main() catches up once it has emptied it
+  if ( !spsc_ring_push(&power_events, &ev) ) power_events_dropped++;
+
+  // main() may be sleeping with the screen off, this has to show up now
+  input_wake();
+}
+
+// Will execute on battery, AC and suspend / resume changes
+static int power_callback(int unknown, int pwrflags, void *common)
+{
+  // -Wextra
+  (void)unknown; (void)common;
+
+  int changed = pwrflags ^ power_last_flags;
+  if (power_last_flags < 0) changed = ~0;
+
+  // Before pushing, so a catch up never sees older flags
+  power_last_flags = pwrflags;
+
+  if ( changed & (PSP_POWER_CB_BATTPOWER | PSP_POWER_CB_BATTERY_LOW | PSP_POWER_CB_BATTERY_EXIST) )
+  {
+    power_event_push(POWER_EVENT_BATTERY, pwrflags);
+  }
+
+  if ( changed & PSP_POWER_CB_AC_POWER )
+  {
+    power_event_push(POWER_EVENT_AC, pwrflags);
+  }
+
+  if ( pwrflags & PSP_POWER_CB_RESUME_COMPLETE )
+  {
+    power_event_push(POWER_EVENT_RESUME, pwrflags);
+  }
+
+  return 0;
+}
+
+// Main thread side of the power events queue
+cbool power_event_pop(power_event* out)
+{
+  if ( spsc_ring_pop(&power_events, out) ) return TRUE;
+
+  uint dropped = power_events_dropped;
+
+  if (dropped == power_events_caught_up) return FALSE;
+  power_events_caught_up = dropped;
+
+  // Stands in for every dropped event, with the newest flags
+  out->type = POWER_EVENT_MISSED;
+  out->flags = power_last_flags;
+  return TRUE;
+}
+
 // Callback Thread
 static int callback_thread(SceSize args, void *argp)
 {
@@ -53,6 +124,14 @@ static int callback_thread(SceSize args, void *argp)
     return -1;
   }
 
+  // Not fatal, main() keeps polling the battery if this fails
+  int pwr_cbid = sceKernelCreateCallback("Power Callback", power_callback, NULL);
+
+  if ( pwr_cbid >= 0 && scePowerRegisterCallback(0, pwr_cbid) >= 0 )
+  {
+    power_callback_registered = TRUE;
+  }
+
   sceKernelSleepThreadCB();
   return 0;
 }
@@ -60,6 +139,8 @@ static int callback_thread(SceSize args, void *argp)
 // Setup Callbacks for exiting app
 int setup_callbacks(void)
 {
+  spsc_ring_init(&power_events, power_events_buf, sizeof(power_event), POWER_EVENT_QUEUE_SIZE);
+
   SceUID thid = sceKernelCreateThread("Callback Update Thread", callback_thread, 0x11, 0xFA0, PSP_THREAD_ATTR_USER, NULL);
   
   if( thid < 0 )
@@ -20,6 +20,28 @@
 #ifndef CALLBACKS_H_
 #define CALLBACKS_H_
 
+#include "utils.h"
+
+// Must be a power of 2
+#define POWER_EVENT_QUEUE_SIZE 16
+
+enum
+{
+  POWER_EVENT_BATTERY,
+  POWER_EVENT_AC,
+  POWER_EVENT_RESUME,
+  POWER_EVENT_MISSED, // Some events were dropped, anything could have changed
+};
+
+typedef struct
+{
+  uchar type;
+  int flags; // PSP_POWER_CB_* at the time of the event
+} power_event;
+
+extern cbool power_callback_registered;
+
 int setup_callbacks(void);
+cbool power_event_pop(power_event* out);
 
 #endif /* CALLBACKS_H_ */
\ No newline at end of file
@@ -0,0 +1,103 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pspkernel.h>
+#include <psprtc.h>
+
+#include "clocktime.h"
+#include "error.h"
+
+// How many times the RTC was read (for checking how often it happens)
+uint clock_time_rtc_reads = 0;
+
+static ScePspDateTime sync_time = {0};
+static SceInt64 sync_sys_time = 0;
+static ScePspDateTime last_time = {0};
+static cbool needs_sync = TRUE;
+
+// Next clock_time_update() will read the RTC (eg.: after resuming from sleep)
+void clock_time_resync(void)
+{
+  needs_sync = TRUE;
+}
+
+static int clock_time_sync(SceInt64 now)
+{
+  if ( sceRtcGetCurrentClockLocalTime(&sync_time) < 0 )
+  {
+    return ERROR_GETTING_TIME_RTC;
+  }
+
+  clock_time_rtc_reads++;
+  sync_sys_time = now;
+  needs_sync = FALSE;
+
+  return 0;
+}
+
+/* Gets the local time, from the RTC only now and then,
+ * otherwise from the time elapsed on the system timer since.
+ * Returns which CLOCK_TIME_* changed, or < 0 if the RTC failed.
+ */
+int clock_time_update(ScePspDateTime* out)
+{
+  if (!out) return ERROR_UNKNOWN;
+
+  SceInt64 now = sceKernelGetSystemTimeWide();
+
+  if ( needs_sync || now - sync_sys_time >= CLOCK_TIME_RESYNC_INTERVAL )
+  {
+    if ( clock_time_sync(now) < 0 ) return ERROR_GETTING_TIME_RTC;
+  }
+
+  ScePspDateTime time = sync_time;
+  SceInt64 us = time.microsecond + (now - sync_sys_time);
+  uint secs = (uint)(us / 1000000);
+
+  uint total_secs = time.second + secs;
+
+  time.microsecond = (uint)(us % 1000000);
+  time.second = total_secs % 60;
+  uint mins = time.minute + total_secs / 60;
+  time.minute = mins % 60;
+  uint hours = time.hour + mins / 60;
+
+  // Past midnight, let the RTC deal with the date
+  if ( hours >= 24 )
+  {
+    if ( clock_time_sync(now) < 0 ) return ERROR_GETTING_TIME_RTC;
+    time = sync_time;
+  }
+  else
+  {
+    time.hour = hours;
+  }
+
+  int changes = 0;
+
+  if (time.second != last_time.second) changes |= CLOCK_TIME_SECOND;
+  if (time.minute != last_time.minute) changes |= CLOCK_TIME_MINUTE;
+  if (time.hour != last_time.hour) changes |= CLOCK_TIME_HOUR;
+  if (time.day != last_time.day || time.month != last_time.month || time.year != last_time.year) changes |= CLOCK_TIME_DAY;
+
+  last_time = time;
+  *out = time;
+
+  return changes;
+}
@@ -0,0 +1,44 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CLOCKTIME_H_
+#define CLOCKTIME_H_
+
+#include <psprtc.h>
+
+#include "utils.h"
+
+// RTC is read again every 10 minutes (in us), in case the user changed the time
+#define CLOCK_TIME_RESYNC_INTERVAL (10LL * 60 * 1000 * 1000)
+
+// What changed since the last clock_time_update()
+enum
+{
+  CLOCK_TIME_SECOND = 1 << 0,
+  CLOCK_TIME_MINUTE = 1 << 1,
+  CLOCK_TIME_HOUR   = 1 << 2,
+  CLOCK_TIME_DAY    = 1 << 3,
+};
+
+extern uint clock_time_rtc_reads;
+
+void clock_time_resync(void);
+int clock_time_update(ScePspDateTime* out);
+
+#endif /* CLOCKTIME_H_ */
@@ -0,0 +1,138 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "damage.h"
+#include "lib/glib2d/glib2d.h"
+
+typedef struct
+{
+  uint key;
+  damage_rect rect;
+} damage_slot;
+
+static damage_slot damage_slots[DAMAGE_SLOTS];
+
+// Damaged this frame, and in the frames before it (for the older buffers)
+static damage_rect damage_curr = {0};
+static damage_rect damage_prev[DAMAGE_BUFFERS - 1];
+
+static int damage_full_frames = DAMAGE_BUFFERS;
+static uint damage_last_style = 0;
+
+static cbool damage_rect_empty(const damage_rect* r)
+{
+  return r->x0 >= r->x1 || r->y0 >= r->y1;
+}
+
+static void damage_rect_add(damage_rect* r, const damage_rect* add)
+{
+  if ( damage_rect_empty(add) ) return;
+
+  if ( damage_rect_empty(r) )
+  {
+    *r = *add;
+    return;
+  }
+
+  if (add->x0 < r->x0) r->x0 = add->x0;
+  if (add->y0 < r->y0) r->y0 = add->y0;
+  if (add->x1 > r->x1) r->x1 = add->x1;
+  if (add->y1 > r->y1) r->y1 = add->y1;
+}
+
+// Everything is redrawn in every buffer
+void damage_invalidate(void)
+{
+  damage_full_frames = DAMAGE_BUFFERS;
+}
+
+// Anything that changes how everything looks (eg.: color, brightness)
+void damage_style(uint style)
+{
+  if (style != damage_last_style) damage_invalidate();
+  damage_last_style = style;
+}
+
+/* Call for everything drawn, every frame that draws, before damage_frame()
+ * pos is the center, key is anything that changes with what's drawn (0 if it's not drawn)
+ */
+void damage_track(int slot, const ScePspFVector2* pos, const ScePspFVector2* size, uint key)
+{
+  if (slot < 0 || slot >= DAMAGE_SLOTS || !pos || !size) return;
+
+  damage_slot* s = &damage_slots[slot];
+
+  // 1 pixel more, for filtering around the edges
+  damage_rect rect =
+  {
+    (int)(pos->x - size->x / 2.0f) - 1, (int)(pos->y - size->y / 2.0f) - 1,
+    (int)(pos->x + size->x / 2.0f) + 1, (int)(pos->y + size->y / 2.0f) + 1,
+  };
+
+  if (key == 0) rect.x1 = rect.x0;
+
+  if ( s->key == key && !memcmp(&s->rect, &rect, sizeof(damage_rect)) ) return;
+
+  // Where it was, and where it is now
+  damage_rect_add(&damage_curr, &s->rect);
+  damage_rect_add(&damage_curr, &rect);
+
+  s->key = key;
+  s->rect = rect;
+}
+
+/* What has to be redrawn in the buffer about to be drawn: whatever changed since it was last drawn
+ * Returns FALSE if it's already up to date
+ */
+cbool damage_frame(damage_rect* out)
+{
+  damage_rect rect = damage_curr;
+
+  for ( int i = 0; i < DAMAGE_BUFFERS - 1; i++ )
+  {
+    damage_rect_add(&rect, &damage_prev[i]);
+  }
+
+  // Shift history
+  for ( int i = DAMAGE_BUFFERS - 2; i > 0; i-- )
+  {
+    damage_prev[i] = damage_prev[i - 1];
+  }
+
+  damage_prev[0] = damage_curr;
+  damage_curr = (damage_rect){0};
+
+  if ( damage_full_frames > 0 )
+  {
+    damage_full_frames--;
+    rect = (damage_rect){ 0, 0, G2D_SCR_W, G2D_SCR_H };
+  }
+
+  // Clip to the screen
+  if (rect.x0 < 0) rect.x0 = 0;
+  if (rect.y0 < 0) rect.y0 = 0;
+  if (rect.x1 > G2D_SCR_W) rect.x1 = G2D_SCR_W;
+  if (rect.y1 > G2D_SCR_H) rect.y1 = G2D_SCR_H;
+
+  if (out) *out = rect;
+
+  return !damage_rect_empty(&rect);
+}
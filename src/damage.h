@@ -0,0 +1,44 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DAMAGE_H_
+#define DAMAGE_H_
+
+#include <psptypes.h>
+
+#include "utils.h"
+
+#define DAMAGE_SLOTS 16
+
+// Frames are drawn into 2 buffers, each one is 2 frames behind when drawn again
+#define DAMAGE_BUFFERS 2
+
+// Screen rectangle, x1 / y1 excluded
+typedef struct
+{
+  int x0, y0;
+  int x1, y1;
+} damage_rect;
+
+void damage_invalidate(void);
+void damage_style(uint style);
+void damage_track(int slot, const ScePspFVector2* pos, const ScePspFVector2* size, uint key);
+cbool damage_frame(damage_rect* out);
+
+#endif /* DAMAGE_H_ */
@@ -0,0 +1,80 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pspkernel.h>
+#include <pspdisplay.h>
+
+#include "display.h"
+
+SceInt64 display_level_time[DISPLAY_LEVEL_COUNT] = {0};
+
+static int display_curr_level = DISPLAY_BRIGHT;
+static int display_last_on_level = DISPLAY_BRIGHT;
+static SceInt64 display_level_since = 0;
+
+static void display_account(void)
+{
+  SceInt64 now = sceKernelGetSystemTimeWide();
+
+  if (display_level_since > 0) display_level_time[display_curr_level] += now - display_level_since;
+  display_level_since = now;
+}
+
+/* Bright / dim levels only change how main() draws,
+ * OFF blanks the screen right away, the next g2dFlip() turns it back on
+ */
+void display_set_level(int level)
+{
+  if (level < 0 || level >= DISPLAY_LEVEL_COUNT) return;
+
+  display_account();
+
+  if ( level == DISPLAY_OFF && display_curr_level != DISPLAY_OFF )
+  {
+    sceDisplaySetFrameBuf(NULL, 0, PSP_DISPLAY_PIXEL_FORMAT_8888, PSP_DISPLAY_SETBUF_IMMEDIATE);
+  }
+
+  if (level != DISPLAY_OFF) display_last_on_level = level;
+  display_curr_level = level;
+}
+
+int display_level(void)
+{
+  return display_curr_level;
+}
+
+cbool display_on(void)
+{
+  return display_curr_level != DISPLAY_OFF;
+}
+
+// Back to the level it was at before being turned off
+void display_wake(void)
+{
+  if ( !display_on() ) display_set_level(display_last_on_level);
+}
+
+void display_end(void)
+{
+  display_account();
+
+  sceKernelPrintf("Display time: bright %lli s, dim %lli s, dimmer %lli s, off %lli s",
+                  display_level_time[DISPLAY_BRIGHT] / 1000000, display_level_time[DISPLAY_DIM] / 1000000,
+                  display_level_time[DISPLAY_DIMMER] / 1000000, display_level_time[DISPLAY_OFF] / 1000000);
+}
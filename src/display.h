@@ -0,0 +1,50 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DISPLAY_H_
+#define DISPLAY_H_
+
+#include <psptypes.h>
+
+#include "utils.h"
+
+// While off, main() still wakes up this often (in us) to keep the clock going
+#define DISPLAY_OFF_WAKE 10000000
+
+// What SELECT goes through, OFF doesn't draw at all
+enum
+{
+  DISPLAY_BRIGHT,
+  DISPLAY_DIM,
+  DISPLAY_DIMMER,
+  DISPLAY_OFF,
+
+  DISPLAY_LEVEL_COUNT
+};
+
+// Time spent (in us) at each level
+extern SceInt64 display_level_time[DISPLAY_LEVEL_COUNT];
+
+void display_set_level(int level);
+int display_level(void);
+cbool display_on(void);
+void display_wake(void);
+void display_end(void);
+
+#endif /* DISPLAY_H_ */
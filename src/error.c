@@ -35,6 +35,7 @@ static const app_error app_errors[] =
   {0x80000000 | -ERROR_TEXTURES_NOT_FOUND,   "ERROR_TEXTURES_NOT_FOUND",   "Textures are missing from 'assets/textures/'!\n  Make sure all PNGs are in the correct directory."},
   {0x80000000 | -ERROR_ALLOCATING_TEXTURES,  "ERROR_ALLOCATING_TEXTURES",  "Unable to allocate memory for textures."},
   {0x80000000 | -ERROR_GETTING_TIME_RTC,     "ERROR_GETTING_TIME_RTC",     "sceRtcGetCurrentClockLocalTime() failed to provide time."},
+  {0x80000000 | -ERROR_ALLOCATING_VRAM,      "ERROR_ALLOCATING_VRAM",      "Unable to allocate VRAM for the screen buffers."},
   {0x80000000 | -ERROR_UNKNOWN,              "ERROR_UNKNOWN",              "Something unknown went very wrong."},
 }; static const uint app_errors_size = ARRAY_SIZE(app_errors);
 
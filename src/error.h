@@ -28,7 +28,8 @@ typedef enum
   ERROR_TEXTURES_NOT_FOUND  = -2,
   ERROR_ALLOCATING_TEXTURES = -3,
   ERROR_GETTING_TIME_RTC    = -4,
-  ERROR_UNKNOWN             = -5
+  ERROR_ALLOCATING_VRAM     = -5,
+  ERROR_UNKNOWN             = -6
 } app_error_type;
 
 typedef struct
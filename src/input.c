@@ -0,0 +1,201 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pspkernel.h>
+#include <pspctrl.h>
+#include <pspdisplay.h>
+
+#include "input.h"
+#include "ring.h"
+#include "main.h"
+
+input_latency input_lat = {0};
+
+static input_event input_events_buf[INPUT_EVENT_QUEUE_SIZE];
+static spsc_ring input_events;
+
+static SceUID input_thid = -1;
+static SceUID input_evflag = -1;
+static volatile cbool input_thread_running = FALSE;
+
+static uint input_last_press[32];
+
+static void input_push(uint pressed, uint time)
+{
+  input_event ev = { .buttons = 0, .time = time };
+
+  // Debounce, ignore buttons pressed again too soon
+  for (int bit = 0; bit < 32; bit++)
+  {
+    uint button = 1u << bit;
+
+    if ( !(pressed & button) ) continue;
+    if ( time - input_last_press[bit] < INPUT_DEBOUNCE ) continue;
+
+    input_last_press[bit] = time;
+    ev.buttons |= button;
+  }
+
+  if (ev.buttons == 0) return;
+
+  spsc_ring_push(&input_events, &ev);
+  input_wake();
+}
+
+// Wakes main() up if it's waiting on input_wait(), also for other events (eg.: power)
+void input_wake(void)
+{
+  if (input_evflag >= 0) sceKernelSetEventFlag(input_evflag, 1);
+}
+
+// Reads the controller every vblank, independently of the frame rate
+static int input_thread(SceSize args, void *argp)
+{
+  // -Wextra
+  (void)args; (void)argp;
+
+  SceCtrlData pad;
+  uint prev_buttons = 0;
+
+  while ( input_thread_running && app_running )
+  {
+    // Blocks until the next sample
+    if ( sceCtrlReadBufferPositive(&pad, 1) < 0 ) continue;
+
+    uint pressed = pad.Buttons & ~prev_buttons;
+    prev_buttons = pad.Buttons;
+
+    if (pressed) input_push(pressed, sceKernelGetSystemTimeLow());
+  }
+
+  return 0;
+}
+
+int input_init(void)
+{
+  spsc_ring_init(&input_events, input_events_buf, sizeof(input_event), INPUT_EVENT_QUEUE_SIZE);
+
+  sceCtrlSetSamplingCycle(0);
+  sceCtrlSetSamplingMode(PSP_CTRL_MODE_DIGITAL);
+
+  input_evflag = sceKernelCreateEventFlag("Input Event Flag", 0, 0, NULL);
+
+  input_thid = sceKernelCreateThread("Input Thread", input_thread, 0x12, 0x1000, PSP_THREAD_ATTR_USER, NULL);
+  if (input_thid < 0) return -1;
+
+  input_thread_running = TRUE;
+
+  if ( sceKernelStartThread(input_thid, 0, NULL) < 0 )
+  {
+    input_thread_running = FALSE;
+    sceKernelDeleteThread(input_thid);
+    input_thid = -1;
+    return -1;
+  }
+
+  return 0;
+}
+
+void input_end(void)
+{
+  if (input_thid >= 0)
+  {
+    input_thread_running = FALSE;
+    sceKernelWaitThreadEnd(input_thid, NULL);
+    sceKernelDeleteThread(input_thid);
+    input_thid = -1;
+  }
+
+  if (input_evflag >= 0)
+  {
+    sceKernelDeleteEventFlag(input_evflag);
+    input_evflag = -1;
+  }
+}
+
+// Without the input thread, main() reads the controller itself
+void input_update(void)
+{
+  if (input_thid >= 0) return;
+
+  SceCtrlLatch latch;
+  sceCtrlReadLatch(&latch);
+
+  if (latch.uiMake) input_push(latch.uiMake, sceKernelGetSystemTimeLow());
+}
+
+cbool input_event_pop(input_event* out)
+{
+  return spsc_ring_pop(&input_events, out);
+}
+
+/* Sleeps until there's input, input_wake() or timeout (in us) has passed
+ * Returns 1 if there's input waiting, 0 otherwise
+ */
+int input_wait(uint timeout)
+{
+  if ( !spsc_ring_empty(&input_events) ) return 1;
+
+  // No input thread, input_update() has to keep polling every vblank
+  if ( input_evflag < 0 || input_thid < 0 )
+  {
+    sceDisplayWaitVblankStart();
+    return 0;
+  }
+
+  SceUInt t = timeout;
+  sceKernelWaitEventFlag(input_evflag, 1, PSP_EVENT_WAITOR | PSP_EVENT_WAITCLEAR, NULL, &t);
+
+  return !spsc_ring_empty(&input_events);
+}
+
+// Press to visible change, a frame is shown on the flip after the one that drew it
+static uint input_lat_press_time = 0;
+static int input_lat_flips = -1;
+
+// Call when ev has changed what's drawn
+void input_latency_mark(const input_event* ev)
+{
+  if (!ev) return;
+
+  input_lat_press_time = ev->time;
+  input_lat_flips = 0;
+}
+
+// Call after every g2dFlip()
+void input_latency_flip(void)
+{
+  if (input_lat_flips < 0) return;
+
+  if (++input_lat_flips < 2) return;
+
+  input_lat.last = sceKernelGetSystemTimeLow() - input_lat_press_time;
+  input_lat_flips = -1;
+
+  // Only a new worst case is worth a line, unless debugging
+  if (input_lat.last > input_lat.max)
+  {
+    input_lat.max = input_lat.last;
+    sceKernelPrintf("Input latency: new max. %u us", input_lat.max);
+  }
+  else
+  {
+    debug_printf("Input latency: %u us (max. %u us)", input_lat.last, input_lat.max);
+  }
+}
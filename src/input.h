@@ -0,0 +1,54 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include "utils.h"
+
+// Must be a power of 2
+#define INPUT_EVENT_QUEUE_SIZE 32
+
+// Presses of the same button closer than this (in us) are ignored
+#define INPUT_DEBOUNCE 50000
+
+typedef struct
+{
+  uint buttons; // PSP_CTRL_* that were just pressed
+  uint time;    // sceKernelGetSystemTimeLow() when read
+} input_event;
+
+typedef struct
+{
+  uint last; // us, from press until the change is on screen
+  uint max;
+} input_latency;
+
+extern input_latency input_lat;
+
+int input_init(void);
+void input_end(void);
+void input_update(void);
+cbool input_event_pop(input_event* out);
+int input_wait(uint timeout);
+void input_wake(void);
+void input_latency_mark(const input_event* ev);
+void input_latency_flip(void);
+
+#endif /* INPUT_H_ */
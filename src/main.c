@@ -27,6 +27,8 @@
 #include <time.h>
 #include <stdlib.h>
 #include <psppower.h>
+#include <pspaudio.h>
+#include <vram.h>
 
 #include "main.h"
 #include "lib/glib2d/glib2d.h"
@@ -36,6 +38,13 @@
 #include "tex.h"
 #include "battery.h"
 #include "music.h"
+#include "clocktime.h"
+#include "input.h"
+#include "alarm.h"
+#include "settings.h"
+#include "display.h"
+#include "damage.h"
+#include "anim.h"
 
 const app_info app_inf = 
 {
@@ -44,7 +53,17 @@ const app_info app_inf =
 };
 
 cbool app_running = TRUE;
-cbool app_play_music = FALSE;
+
+// What's tracked for partial redraws
+enum
+{
+  DAMAGE_TIME,
+  DAMAGE_COLON,
+  DAMAGE_DATE,
+  DAMAGE_BAT,
+  DAMAGE_MUSIC,
+  DAMAGE_ALARM,
+};
 
 PSP_MODULE_INFO("Digital Clock", PSP_MODULE_USER, app_inf.v.major, app_inf.v.minor);
 PSP_MAIN_THREAD_ATTR(PSP_THREAD_ATTR_USER | PSP_THREAD_ATTR_VFPU);
@@ -63,18 +82,25 @@ int main(int args, char* argv[])
     app_error_display(ERROR_SETUP_CALLBACKS);
   }
   
-  // Neither should allocating mem for textures
-  // Error handling is done by the function itself
-  if ( clock_tex_alloc() < 0 )
+  // Hold Square while starting to draw seven segment glyphs instead of loading textures
+  SceCtrlData start_pad;
+  if ( sceCtrlPeekBufferPositive(&start_pad, 1) > 0 && (start_pad.Buttons & PSP_CTRL_SQUARE) )
   {
-    app_running = FALSE;
+    clock_glyphs = CLOCK_GLYPHS_SEGMENTS;
   }
 
+  // Textures load in the background while the rest is initialized
+  // Nothing may use the heap until clock_tex_alloc_wait() (no malloc(), glib2d, music...)
+  clock_tex_alloc();
+
   srand(time(NULL));
   get_app_v_string(&app_inf);
 
-  // Was music initialized correctly?
-  cbool music_initialized = music_init() == 0;
+  // Not fatal, main() reads the controller itself if this fails
+  input_init();
+
+  // Missing or corrupt settings are simply reset
+  settings_load();
 
   // Forces PPSSPP to play .mp3 with sampling rates != 44100
   // Take a look around https://github.com/hrydgard/ppsspp/blob/master/Core/HLE/sceMp3.cpp#L479
@@ -96,159 +122,381 @@ int main(int args, char* argv[])
                                    GREEN, SPRING_GREEN, CYAN, AZURE, BLUE, 
                                    VIOLET, MAGENTA, ROSE, WHITE, GRAY};
   const int clock_colors_size = ARRAY_SIZE(clock_colors);
-  int curr_clock_color_index = 0;
+  int curr_clock_color_index = settings.color < clock_colors_size ? settings.color : 0;
 
-  // Available Brightness Modes (Square to change)
+  // Available Brightness Modes (Select to change), one per DISPLAY_* level that draws
   const uchar brightness_modes[] = { 255, 128, 64 };
   const uchar brightness_modes_size = ARRAY_SIZE(brightness_modes);
-  int curr_brightness_index = 0;
+  int curr_brightness_index = settings.brightness < brightness_modes_size ? settings.brightness : 0;
+  display_set_level(curr_brightness_index);
   
   const ScePspFVector2 clock_big_size_sprites = { 80.0f, 160.0f };
   const ScePspFVector2 clock_small_size_sprites = { 20.0f, 40.0f };
   
-  const ScePspFVector2 clock_time_pos_sprites = { 60.0f, 120.0f };
-  ScePspFVector2 clock_date_pos_sprites = { 360.0f, 240.0f };
-
   const ScePspFVector2 clock_bat_pos_sprite = { 330.0f, 240.0f };
   const ScePspFVector2 clock_music_pos_sprite = { 300.0f, 240.0f };
-  
-  ScePspFVector2 curr_pos_time_sprites = clock_time_pos_sprites;
-  ScePspFVector2 curr_pos_date_sprites = clock_date_pos_sprites;
+  const ScePspFVector2 clock_alarm_pos_sprite = { 270.0f, 240.0f };
 
   // Centered
   const ScePspFVector2 clock_time_pos_colon = { (float)G2D_SCR_W / 2.0f, 120.0f };
   const ScePspFVector2 clock_date_pos_dot   = { 410.0f, 240.0f };
+
+  // All time / date tiles (and the dot)
+  const ScePspFVector2 clock_time_pos_block = { 240.0f, 120.0f };
+  const ScePspFVector2 clock_time_size_block = { 440.0f, 160.0f + 2.0f * CLOCK_TIME_ANIM_SLIDE };
+  const ScePspFVector2 clock_date_pos_block = { 405.0f, 240.0f };
+  const ScePspFVector2 clock_date_size_block = { 110.0f, 40.0f };
+
+  damage_rect damage;
   
   ScePspDateTime curr_time = {0};
-  int old_min = -1;
+  int time_changes;
 
-  SceCtrlLatch latch;
-  ScePspDateTime time_cust;
+  input_event in_ev;
 
   app_tex* bat_tex;
+  bat_monitor_init(power_callback_registered ? BAT_SAMPLE_INTERVAL_EVENTS : BAT_SAMPLE_INTERVAL);
+
+  power_event pwr_ev;
+
+  cbool music_shown = FALSE;
+  int music_track_shown = -1;
+
+  // A frame only shows up on the flip after the one that drew it,
+  // so after something changes it takes 2 frames before nothing has to be drawn
+  int redraw_frames = 2;
+
+  // Frames drawn since the minute changed
+  uint minute_frames = 0;
+
+  anim_init();
+  clock_time_anim_enable(settings.animations);
+
+  // Allocating mem for textures should never fail
+  // Error handling is done by the function itself
+  if ( clock_tex_alloc_wait() < 0 )
+  {
+    app_running = FALSE;
+  }
+
+  // Was music initialized correctly?
+  cbool music_initialized = music_init(settings.track) == 0;
+
+  if ( music_initialized )
+  {
+    music_cmd_send(MUSIC_CMD_VOLUME, settings.volume);
+    if (settings.music_on) music_cmd_send(MUSIC_CMD_PLAY, 0);
+  }
+
+  // Alarms play music if there's any, otherwise they beep
+  alarm_init(music_initialized);
+  if (!settings.alarms_armed) alarm_set_armed(FALSE);
+
+  // Solid colors on black don't need more than 16 bits, clears and blending cost half
+  // Nothing uses depth either, so no depth buffer to clear or keep in VRAM
+  if ( g2dInitMode(G2D_PSM_5650 | G2D_NO_DEPTH) < 0 )
+  {
+    app_running = FALSE;
+    app_error_display(ERROR_ALLOCATING_VRAM);
+  }
 
-  g2dInit();
+  sceKernelPrintf("VRAM free: %u bytes", (unsigned int)vmemavail());
+
+  // Not fatal, digits are drawn one by one without it
+  clock_time_tex_alloc(&clock_big_size_sprites);
   
   while ( app_running )
   {
-    // GRAPHICS ///////////////////////////////////////
+    // POWER //////////////////////////////////////////
 
-    curr_pos_time_sprites.x = clock_time_pos_sprites.x;
-    curr_pos_date_sprites.x = clock_date_pos_sprites.x;
+    // Battery, AC and resume changes come from the power callback
+    while ( power_event_pop(&pwr_ev) )
+    {
+      redraw_frames = 2;
 
-    g2dClear(bg_color);
-    
-    // Check if curr_time has been initialized
-    if (curr_time.year != 0)
+      switch (pwr_ev.type)
+      {
+        // Time has passed while sleeping, or events were dropped and anything could have changed
+        case POWER_EVENT_RESUME:
+        case POWER_EVENT_MISSED:
+          clock_time_resync();
+          bat_monitor_invalidate();
+          break;
+
+        // Battery charges whenever AC is plugged in
+        case POWER_EVENT_AC:
+        case POWER_EVENT_BATTERY:
+        default:
+          bat_monitor_invalidate();
+          break;
+      }
+    }
+
+    // POWER //////////////////////////////////////////
+
+    // CONTROLS ///////////////////////////////////////
+
+    // Presses come from the input thread, handled before drawing so they show up this frame
+    input_update();
+
+    while ( input_event_pop(&in_ev) )
     {
-      old_min = curr_time.minute;
+      uint pressed = in_ev.buttons;
+
+      redraw_frames = 2;
+
+      // Any button stops a ringing alarm, and does nothing else
+      if ( alarm_ringing() )
+      {
+        alarm_dismiss();
+        input_latency_mark(&in_ev);
+        continue;
+      }
+
+      // Any button turns the screen back on, and does nothing else
+      if ( !display_on() )
+      {
+        display_wake();
+        input_latency_mark(&in_ev);
+        continue;
+      }
+
+      // Press START to change color
+      if ( pressed & PSP_CTRL_START )
+      {
+        curr_clock_color_index = (curr_clock_color_index + 1) % clock_colors_size;
+        settings.color = curr_clock_color_index;
+      }
+
+      // Press Select to change brightness mode, the last one turns the screen off
+      if ( pressed & PSP_CTRL_SELECT )
+      {
+        display_set_level((display_level() + 1) % DISPLAY_LEVEL_COUNT);
+
+        if ( display_on() )
+        {
+          curr_brightness_index = display_level();
+          settings.brightness = curr_brightness_index;
+        }
+      }
+
+      // Press Cross to toggle playing music
+      // Music runs on its own thread, none of these wait for it
+      if ( pressed & PSP_CTRL_CROSS && music_initialized )
+      {
+        music_cmd_send(music_enabled() ? MUSIC_CMD_STOP : MUSIC_CMD_PLAY, 0);
+      }
+
+      // Press Left or Right to switch current music
+      if (music_enabled())
+      {
+        if ( pressed & PSP_CTRL_LEFT )
+        {
+          music_cmd_send(MUSIC_CMD_PREV, 0);
+        }
+        else if ( pressed & PSP_CTRL_RIGHT )
+        {
+          music_cmd_send(MUSIC_CMD_NEXT, 0);
+        }
+
+        // Press Up or Down to change the volume
+        if ( pressed & (PSP_CTRL_UP | PSP_CTRL_DOWN) )
+        {
+          int volume = settings.volume + (pressed & PSP_CTRL_UP ? MUSIC_VOLUME_STEP : -MUSIC_VOLUME_STEP);
+
+          if (volume < 0) volume = 0;
+          if (volume > PSP_AUDIO_VOLUME_MAX) volume = PSP_AUDIO_VOLUME_MAX;
+
+          if ( music_cmd_send(MUSIC_CMD_VOLUME, volume) ) settings.volume = volume;
+        }
+      }
+
+      // Press Triangle to turn alarms on / off
+      if ( pressed & PSP_CTRL_TRIANGLE && alarm_cfg.count > 0 )
+      {
+        alarm_set_armed(!alarm_cfg.armed);
+        settings.alarms_armed = alarm_cfg.armed;
+      }
+
+      // Press Circle to turn digit animations on / off
+      if ( pressed & PSP_CTRL_CIRCLE )
+      {
+        settings.animations = !settings.animations;
+        clock_time_anim_enable(settings.animations);
+      }
+
+      // Color, brightness, music and alarm icon changes are visible
+      if ( (pressed & (PSP_CTRL_START | PSP_CTRL_SELECT)) || (pressed & PSP_CTRL_CROSS && music_initialized) || (pressed & PSP_CTRL_TRIANGLE && alarm_cfg.count > 0) )
+      {
+        input_latency_mark(&in_ev);
+      }
     }
 
-    // // This should never fail, otherwise something is horribly wrong!
-    if ( sceRtcGetCurrentClockLocalTime(&curr_time) < 0 )
+    // CONTROLS ///////////////////////////////////////
+
+    // CLOCK //////////////////////////////////////////
+
+    // RTC is only read now and then, this should never fail, otherwise something is horribly wrong!
+    time_changes = clock_time_update(&curr_time);
+
+    if ( time_changes < 0 )
     {
       app_running = FALSE;
       app_error_display(ERROR_GETTING_TIME_RTC);
     }
-    
-    // For checking if min has changed (instead of building the texture array every cycle)
-    if ( old_min != curr_time.minute )
+
+    if ( time_changes ) redraw_frames = 2;
+
+    // Only build the texture array when the displayed time / date has changed
+    // Even with the screen off, so it isn't stale once it turns back on
+    if ( time_changes & (CLOCK_TIME_MINUTE | CLOCK_TIME_HOUR | CLOCK_TIME_DAY) )
     {
       clock_build_curr_tex_draw(&curr_time);
-      clock_build_curr_tex_draw(&curr_time);
     }
-    
-    // Clock display time: 4 digits (2 for hour and 2 for min)
-    for ( int tile = 0; tile < 4; tile++ )
+
+    if ( time_changes & CLOCK_TIME_MINUTE )
     {
-      // Draw if it's not NULL (eg.: first tile is 0)
-      if (curr_tex_draw.time[tile])
-      {
-        tex_draw(curr_tex_draw.time[tile], &curr_pos_time_sprites, &clock_big_size_sprites, G2D_MODULATE(clock_colors[curr_clock_color_index], brightness_modes[curr_brightness_index], 255));
-      }
-      
-      curr_pos_time_sprites.x += 120.0f;
+      debug_printf("Frames drawn last minute: %u (animations %s)", minute_frames, settings.animations ? "on" : "off");
+      minute_frames = 0;
     }
 
-    sceRtcGetCurrentClockLocalTime(&time_cust);
-    
-    // Draw colon every even second (for blinking)
-    if ( time_cust.second % 2 == 0 )
+    // Alarm blinks while ringing, and turns the screen on
+    if ( alarm_update(&curr_time, time_changes) || alarm_ringing() )
     {
-      tex_draw(&main_clock_tex.s.colon, &clock_time_pos_colon, &clock_big_size_sprites, G2D_MODULATE(clock_colors[curr_clock_color_index], brightness_modes[curr_brightness_index], 255));
+      redraw_frames = 2;
+      if ( alarm_ringing() ) display_wake();
     }
 
-    for ( int tile = 0; tile < 4; tile++ )
+    if ( bat_monitor_update(&bat_tex) ) redraw_frames = 2;
+
+    if ( music_enabled() != music_shown )
+    {
+      music_shown = !music_shown;
+      redraw_frames = 2;
+    }
+
+    // Whatever music was doing last is kept for next time
+    if ( music_initialized )
     {
-      // Draw if it's not NULL (eg.: first tile is 0)
-      if (curr_tex_draw.date[tile])
+      music_status status;
+      music_get_status(&status);
+
+      // An alarm playing music doesn't count
+      if (!alarm_ringing()) settings.music_on = music_shown;
+
+      // Kept by name, only hashed again when the track changes
+      if ( status.track != music_track_shown )
       {
-        tex_draw(curr_tex_draw.date[tile], &curr_pos_date_sprites, &clock_small_size_sprites, G2D_MODULATE(clock_colors[curr_clock_color_index], brightness_modes[curr_brightness_index], 255));
+        music_track_shown = status.track;
+        settings.track = music_track_hash(status.track);
       }
-      
-      curr_pos_date_sprites.x += 30.0f;
     }
 
-    tex_draw(&main_clock_tex.s.dot_bottom, &clock_date_pos_dot, &clock_small_size_sprites, G2D_MODULATE(clock_colors[curr_clock_color_index], brightness_modes[curr_brightness_index], 255));
-    
-    get_tex_by_curr_bat_status(&bat_tex);
+    // Only written once they stop changing for a while
+    settings_update();
+
+    // Every frame is drawn while something animates, back to sleeping afterwards
+    if ( anim_active() ) redraw_frames = 2;
 
-    tex_draw(bat_tex, &clock_bat_pos_sprite, &clock_small_size_sprites, G2D_MODULATE(clock_colors[curr_clock_color_index], brightness_modes[curr_brightness_index], 255));
+    // Screen is off, nothing is drawn until a button or alarm turns it back on
+    if ( !display_on() )
+    {
+      uint alarm_timeout = alarm_time_until(&curr_time);
+
+      input_wait(alarm_timeout < DISPLAY_OFF_WAKE ? alarm_timeout : DISPLAY_OFF_WAKE);
+
+      redraw_frames = 2;
+      continue;
+    }
 
-    if (app_play_music)
+    // Nothing new to show, sleep until the next second, alarm or button press
+    if ( redraw_frames == 0 )
     {
-      tex_draw(&main_clock_tex.s.icon_music, &clock_music_pos_sprite, &clock_small_size_sprites, G2D_MODULATE(clock_colors[curr_clock_color_index], brightness_modes[curr_brightness_index], 255));
+      uint timeout = 1000000 - curr_time.microsecond;
+      uint alarm_timeout = alarm_time_until(&curr_time);
+
+      input_wait(alarm_timeout < timeout ? alarm_timeout : timeout);
+      continue;
     }
 
-    g2dFlip(G2D_VSYNC);
+    // CLOCK //////////////////////////////////////////
 
     // GRAPHICS ///////////////////////////////////////
 
-    // CONTROLS ///////////////////////////////////////
+    const g2dColor clock_color = G2D_MODULATE(clock_colors[curr_clock_color_index], brightness_modes[curr_brightness_index], 255);
 
-    sceCtrlReadLatch(&latch);
+    // Draw colon every even second (for blinking)
+    cbool colon_shown = curr_time.second % 2 == 0;
 
-    // Press START to change color
-    if ( latch.uiMake & PSP_CTRL_START )
-    {
-      curr_clock_color_index = (curr_clock_color_index + 1) % clock_colors_size;
-    }
+    // Blinks once a second while ringing (on for the first half)
+    cbool alarm_shown = alarm_armed() && (!alarm_ringing() || curr_time.microsecond < 500000);
 
-    // Press Select to change brightness mode
-    if ( latch.uiMake & PSP_CTRL_SELECT )
-    {
-      curr_brightness_index = (curr_brightness_index + 1) % brightness_modes_size;
-    }
+    // Changes every frame while the digits animate (hour * 60 + minute < 2048)
+    uint time_anim_phase = clock_time_anim_update();
 
-    // Press Cross to toggle playing music
-    if ( latch.uiMake & PSP_CTRL_CROSS && music_initialized )
+    // Only what changed since this buffer was last drawn is drawn again
+    damage_style(clock_color);
+    damage_track(DAMAGE_TIME, &clock_time_pos_block, &clock_time_size_block, (curr_time.hour * 60 + curr_time.minute + 1) | (time_anim_phase << 11));
+    damage_track(DAMAGE_COLON, &clock_time_pos_colon, &clock_big_size_sprites, colon_shown);
+    damage_track(DAMAGE_DATE, &clock_date_pos_block, &clock_date_size_block, curr_time.month * 32 + curr_time.day + 1);
+    damage_track(DAMAGE_BAT, &clock_bat_pos_sprite, &clock_small_size_sprites, bat_tex - main_clock_tex.a + 1);
+    damage_track(DAMAGE_MUSIC, &clock_music_pos_sprite, &clock_small_size_sprites, music_shown);
+    damage_track(DAMAGE_ALARM, &clock_alarm_pos_sprite, &clock_small_size_sprites, alarm_shown);
+
+    if ( damage_frame(&damage) )
     {
-      app_play_music = !app_play_music;
-      if (app_play_music) music_play_random(FALSE);
-      else 
+      // Switches render targets, which resets the scissor
+      clock_time_tex_compose(&clock_big_size_sprites);
+
+      g2dSetScissor(damage.x0, damage.y0, damage.x1 - damage.x0, damage.y1 - damage.y0);
+      g2dClear(bg_color);
+
+      // Clock display time: 4 digits (2 for hour and 2 for min), as one sprite
+      clock_draw_time(&clock_big_size_sprites, clock_color);
+
+      if ( colon_shown )
       {
-        if (music_thread_playing) music_stop();
+        tex_draw(&main_clock_tex.s.colon, &clock_time_pos_colon, &clock_big_size_sprites, clock_color);
       }
-    }
 
-    // Press Left or Right to switch current music
-    if (app_play_music)
-    {
-      if ( latch.uiMake & PSP_CTRL_LEFT )
+      for ( int tile = 0; tile < 4; tile++ )
       {
-        player_skipped_song = TRUE;
-        music_play_random(TRUE);
+        // Draw if it's not NULL (eg.: first tile is 0)
+        if (curr_tex_draw.date[tile])
+        {
+          tex_draw(curr_tex_draw.date[tile], &clock_tex_layout.date[tile], &clock_small_size_sprites, clock_color);
+        }
       }
-      else if ( latch.uiMake & PSP_CTRL_RIGHT )
+
+      tex_draw(&main_clock_tex.s.dot_bottom, &clock_date_pos_dot, &clock_small_size_sprites, clock_color);
+
+      tex_draw(bat_tex, &clock_bat_pos_sprite, &clock_small_size_sprites, clock_color);
+
+      if (music_shown)
       {
-        player_skipped_song = TRUE;
-        music_play_random(FALSE);
+        tex_draw(&main_clock_tex.s.icon_music, &clock_music_pos_sprite, &clock_small_size_sprites, clock_color);
+      }
+
+      if (alarm_shown)
+      {
+        tex_draw(&main_clock_tex.s.alarm_dot, &clock_alarm_pos_sprite, &clock_small_size_sprites, clock_color);
       }
     }
 
-    // CONTROLS ///////////////////////////////////////
+    g2dFlip(G2D_VSYNC);
+    input_latency_flip();
+    minute_frames++;
+
+    if ( redraw_frames > 0 ) redraw_frames--;
+
+    // GRAPHICS ///////////////////////////////////////
   }
 
+  settings_save();
+  display_end();
+
+  input_end();
+  alarm_end();
   g2dTerm();
   clock_tex_free();
   music_end();
@@ -24,6 +24,5 @@
 
 extern const app_info app_inf;
 extern cbool app_running;
-extern cbool app_play_music;
 
 #endif /* MAIN_H_ */
\ No newline at end of file
@@ -0,0 +1,103 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mixer.h"
+
+void mixer_gain_init(mixer_gain* m, int gain)
+{
+  if (!m) return;
+
+  m->gain = gain;
+  m->target = gain;
+  m->step = 0;
+}
+
+// Goes from the current gain to target in frames sample frames
+void mixer_gain_ramp(mixer_gain* m, int target, uint frames)
+{
+  if (!m) return;
+
+  m->target = target;
+
+  if (frames == 0)
+  {
+    m->gain = target;
+    m->step = 0;
+    return;
+  }
+
+  m->step = (target - m->gain) / (int)frames;
+
+  // Never stall on tiny differences
+  if (m->step == 0 && target != m->gain) m->step = target > m->gain ? 1 : -1;
+}
+
+cbool mixer_gain_ramping(const mixer_gain* m)
+{
+  return m->gain != m->target;
+}
+
+// Constant gain, 4 samples at a time (interleaved channels don't matter here)
+static void mixer_gain_apply_const(int gain, short* buf, uint samples)
+{
+  uint i = 0;
+
+  for (; i + 4 <= samples; i += 4)
+  {
+    buf[i + 0] = (short)((buf[i + 0] * gain) >> 15);
+    buf[i + 1] = (short)((buf[i + 1] * gain) >> 15);
+    buf[i + 2] = (short)((buf[i + 2] * gain) >> 15);
+    buf[i + 3] = (short)((buf[i + 3] * gain) >> 15);
+  }
+
+  for (; i < samples; i++)
+  {
+    buf[i] = (short)((buf[i] * gain) >> 15);
+  }
+}
+
+/* Applies the gain to a buffer of interleaved 16-bit samples
+ * Gain stays between 0 and MIXER_UNITY, so there's no clipping
+ */
+void mixer_gain_apply(mixer_gain* m, short* buf, uint frames, uint channels)
+{
+  if (!m || !buf || channels == 0) return;
+
+  uint frame = 0;
+
+  // Ramping, gain changes every sample frame
+  for (; frame < frames && m->gain != m->target; frame++)
+  {
+    m->gain += m->step;
+
+    if ( (m->step > 0 && m->gain > m->target) || (m->step < 0 && m->gain < m->target) )
+    {
+      m->gain = m->target;
+    }
+
+    for (uint ch = 0; ch < channels; ch++)
+    {
+      buf[frame * channels + ch] = (short)((buf[frame * channels + ch] * m->gain) >> 15);
+    }
+  }
+
+  if (frame >= frames || m->gain == MIXER_UNITY) return;
+
+  mixer_gain_apply_const(m->gain, buf + frame * channels, (frames - frame) * channels);
+}
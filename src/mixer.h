@@ -0,0 +1,40 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MIXER_H_
+#define MIXER_H_
+
+#include "utils.h"
+
+// Gains are Q15 fixed-point, same scale as PSP_AUDIO_VOLUME_MAX
+#define MIXER_UNITY (1 << 15)
+
+typedef struct
+{
+  int gain;
+  int target;
+  int step; // Per sample frame
+} mixer_gain;
+
+void mixer_gain_init(mixer_gain* m, int gain);
+void mixer_gain_ramp(mixer_gain* m, int target, uint frames);
+cbool mixer_gain_ramping(const mixer_gain* m);
+void mixer_gain_apply(mixer_gain* m, short* buf, uint frames, uint channels);
+
+#endif /* MIXER_H_ */
@@ -0,0 +1,240 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "mp3info.h"
+
+// Layer III, in kbit/s: [MPEG1 / MPEG2 and 2.5][index], 0 is free format (not supported)
+static const uint mp3_bitrates[2][16] =
+{
+  { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 },
+  { 0,  8, 16, 24, 32, 40, 48, 56,  64,  80,  96, 112, 128, 144, 160, 0 },
+};
+
+// Hz: [MP3_MPEG*][index]
+static const uint mp3_sample_rates[3][4] =
+{
+  { 44100, 48000, 32000, 0 },
+  { 22050, 24000, 16000, 0 },
+  { 11025, 12000,  8000, 0 },
+};
+
+static uint mp3_syncsafe(const byte* b)
+{
+  return ((b[0] & 0x7F) << 21) | ((b[1] & 0x7F) << 14) | ((b[2] & 0x7F) << 7) | (b[3] & 0x7F);
+}
+
+static uint mp3_be32(const byte* b)
+{
+  return ((uint)b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3];
+}
+
+static uint mp3_le32(const byte* b)
+{
+  return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint)b[3] << 24);
+}
+
+// Whole ID3v2 tag at the start of buf (header and footer included), 0 if there's none
+uint mp3_id3v2_size(const byte* buf, uint len)
+{
+  if ( !buf || len < 10 || memcmp(buf, "ID3", 3) != 0 ) return 0;
+
+  // Version, and the size bytes only use 7 bits each
+  if ( buf[3] == 0xFF || buf[4] == 0xFF || (buf[6] | buf[7] | buf[8] | buf[9]) & 0x80 ) return 0;
+
+  uint size = 10 + mp3_syncsafe(&buf[6]);
+
+  // ID3v2.4 footer
+  if (buf[5] & 0x10) size += 10;
+
+  return size;
+}
+
+/* Layer III frame header in the first 4 bytes of buf
+ * Returns < 0 if it isn't one
+ */
+int mp3_frame_parse(const byte* buf, mp3_frame* out)
+{
+  if (!buf) return -1;
+
+  // 11 sync bits
+  if ( buf[0] != 0xFF || (buf[1] & 0xE0) != 0xE0 ) return -1;
+
+  uint version_bits = (buf[1] >> 3) & 0x3;
+  uint layer_bits = (buf[1] >> 1) & 0x3;
+  uint bitrate_index = buf[2] >> 4;
+  uint rate_index = (buf[2] >> 2) & 0x3;
+  uint padding = (buf[2] >> 1) & 0x1;
+  uint channel_mode = buf[3] >> 6;
+
+  // 01 is reserved, and only layer III (01) is played
+  if ( version_bits == 1 || layer_bits != 1 ) return -1;
+
+  mp3_frame frame;
+  frame.version = version_bits == 3 ? MP3_MPEG1 : version_bits == 2 ? MP3_MPEG2 : MP3_MPEG25;
+  frame.bitrate = mp3_bitrates[frame.version != MP3_MPEG1][bitrate_index];
+  frame.sample_rate = mp3_sample_rates[frame.version][rate_index];
+
+  if ( frame.bitrate == 0 || frame.sample_rate == 0 ) return -1;
+
+  frame.channels = channel_mode == 3 ? 1 : 2;
+  frame.samples = frame.version == MP3_MPEG1 ? 1152 : 576;
+  frame.size = (frame.samples / 8) * frame.bitrate * 1000 / frame.sample_rate + padding;
+
+  if (out) *out = frame;
+
+  return 0;
+}
+
+/* Offset of the first frame in buf, whose next frame (if it's in buf) agrees with it
+ * Random 0xFF bytes in leftover tag data can look like a header, two in a row rarely do
+ * Returns < 0 if there's none
+ */
+int mp3_frame_find(const byte* buf, uint len, mp3_frame* out)
+{
+  if ( !buf || len < 4 ) return -1;
+
+  for (uint offset = 0; offset + 4 <= len; offset++)
+  {
+    if (buf[offset] != 0xFF) continue;
+
+    mp3_frame frame, next;
+    if ( mp3_frame_parse(&buf[offset], &frame) < 0 ) continue;
+
+    uint next_offset = offset + frame.size;
+
+    if ( next_offset + 4 <= len )
+    {
+      if ( mp3_frame_parse(&buf[next_offset], &next) < 0 ) continue;
+      if ( next.version != frame.version || next.sample_rate != frame.sample_rate ) continue;
+    }
+
+    if (out) *out = frame;
+    return offset;
+  }
+
+  return -1;
+}
+
+/* Bytes of tags at the end of the file, tail being its last len bytes
+ * ID3v1 is always last, an APEv2 tag can be right before it (or last)
+ */
+uint mp3_trailer_size(const byte* tail, uint len)
+{
+  if (!tail) return 0;
+
+  uint size = 0;
+
+  if ( len >= 128 && memcmp(&tail[len - 128], "TAG", 3) == 0 ) size += 128;
+
+  if ( len >= size + 32 )
+  {
+    const byte* footer = &tail[len - size - 32];
+
+    if ( memcmp(footer, "APETAGEX", 8) == 0 )
+    {
+      // Tag size counts the items and the footer, the header is only there if flagged
+      size += mp3_le32(&footer[12]);
+      if (mp3_le32(&footer[20]) & 0x80000000) size += 32;
+    }
+  }
+
+  return size;
+}
+
+// Xing / Info header (LAME writes it, "Info" for CBR), right after the first frame's side info
+static cbool mp3_xing_parse(const byte* buf, uint len, mp3_info* info)
+{
+  uint side_info = info->frame.version == MP3_MPEG1 ? (info->frame.channels == 1 ? 17 : 32)
+                                                    : (info->frame.channels == 1 ?  9 : 17);
+  uint at = 4 + side_info;
+
+  if ( at + 8 > len || (memcmp(&buf[at], "Xing", 4) != 0 && memcmp(&buf[at], "Info", 4) != 0) ) return FALSE;
+
+  uint flags = mp3_be32(&buf[at + 4]);
+  at += 8;
+
+  if (flags & 0x1)
+  {
+    if (at + 4 > len) return FALSE;
+    info->frames = mp3_be32(&buf[at]);
+    at += 4;
+  }
+
+  if (flags & 0x2) at += 4;   // Bytes
+  if (flags & 0x4) at += 100; // Seek table
+  if (flags & 0x8) at += 4;   // Quality
+
+  uint samples = info->frames * info->frame.samples;
+
+  // LAME tag: encoder delay and padding (12 bits each), not part of the song
+  if ( at + 24 <= len && memcmp(&buf[at], "LAME", 4) == 0 )
+  {
+    uint delay = (buf[at + 21] << 4) | (buf[at + 22] >> 4);
+    uint padding = ((buf[at + 22] & 0x0F) << 8) | buf[at + 23];
+
+    if (delay + padding < samples) samples -= delay + padding;
+  }
+
+  if (info->frames) info->duration = (uint)((unsigned long long)samples * 1000 / info->frame.sample_rate);
+
+  return info->frames != 0;
+}
+
+// VBRI header (Fraunhofer encoders), always 32 bytes after the first frame's header
+static cbool mp3_vbri_parse(const byte* buf, uint len, mp3_info* info)
+{
+  uint at = 4 + 32;
+
+  if ( at + 18 > len || memcmp(&buf[at], "VBRI", 4) != 0 ) return FALSE;
+
+  info->frames = mp3_be32(&buf[at + 14]);
+  if (info->frames) info->duration = (uint)((unsigned long long)info->frames * info->frame.samples * 1000 / info->frame.sample_rate);
+
+  return info->frames != 0;
+}
+
+/* Fills info from the start of the stream (buf, len bytes of it)
+ * info's stream_start / stream_end have to be set already, the duration of CBR files comes from them
+ * Returns < 0 if it doesn't start with a frame
+ */
+int mp3_info_parse(const byte* buf, uint len, mp3_info* info)
+{
+  if ( !buf || !info || len < 4 ) return -1;
+  if ( mp3_frame_parse(buf, &info->frame) < 0 ) return -1;
+
+  info->frames = 0;
+  info->duration = 0;
+
+  uint stream_size = info->stream_end > info->stream_start ? info->stream_end - info->stream_start : 0;
+
+  if ( mp3_xing_parse(buf, len, info) || mp3_vbri_parse(buf, len, info) )
+  {
+    info->bitrate = info->duration ? (uint)((unsigned long long)stream_size * 8 / info->duration) : info->frame.bitrate;
+  }
+  else
+  {
+    // No header, so it's CBR (or close enough)
+    info->bitrate = info->frame.bitrate;
+    info->duration = (uint)((unsigned long long)stream_size * 8 / info->bitrate);
+  }
+
+  return 0;
+}
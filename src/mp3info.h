@@ -0,0 +1,69 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MP3INFO_H_
+#define MP3INFO_H_
+
+#include "utils.h"
+
+// Bytes read after the tags when looking for the first frame
+#define MP3_PROBE_SIZE 4096
+
+// How far past the tags the first frame is looked for, in MP3_PROBE_SIZE chunks
+#define MP3_SEARCH_LIMIT (64 * 1024)
+
+// Read from the end of the file for ID3v1 (128) and an APEv2 footer (32) before it
+#define MP3_TRAILER_PROBE_SIZE (128 + 32)
+
+enum
+{
+  MP3_MPEG1,
+  MP3_MPEG2,
+  MP3_MPEG25,
+};
+
+// One MPEG audio layer III frame header
+typedef struct
+{
+  uchar version;     // MP3_MPEG*
+  uchar channels;
+  uint bitrate;      // kbit/s
+  uint sample_rate;  // Hz
+  uint size;         // Bytes, header included
+  uint samples;      // Per channel
+} mp3_frame;
+
+// What's known about a file before playing it
+typedef struct
+{
+  uint stream_start; // Bytes, past the tags
+  uint stream_end;
+  mp3_frame frame;   // The first one
+  uint frames;       // From a Xing / VBRI header, 0 without one
+  uint duration;     // ms
+  uint bitrate;      // Average, kbit/s
+} mp3_info;
+
+uint mp3_id3v2_size(const byte* buf, uint len);
+int mp3_frame_parse(const byte* buf, mp3_frame* out);
+int mp3_frame_find(const byte* buf, uint len, mp3_frame* out);
+uint mp3_trailer_size(const byte* tail, uint len);
+int mp3_info_parse(const byte* buf, uint len, mp3_info* info);
+
+#endif /* MP3INFO_H_ */
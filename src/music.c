@@ -30,6 +30,9 @@
 #include "music.h"
 #include "utils.h"
 #include "main.h"
+#include "ring.h"
+#include "mixer.h"
+#include "mp3info.h"
 
 static const char* psp_music_folder = "ms0:/MUSIC/";
 
@@ -63,6 +66,11 @@ void music_playlist_clear(music_playlist* playlist)
 
 music_playlist current_playlist;
 
+static int current_playlist_order[MUSIC_PLAYLIST_SIZE];
+static int current_song_index = 0;
+
+static int music_thread_start();
+
 int music_init_modules()
 {
   if (sceUtilityLoadModule(PSP_MODULE_AV_AVCODEC) < 0) return -1;
@@ -78,20 +86,22 @@ int music_end_modules()
   return 0;
 }
 
-int music_init()
+// start_track is music_track_hash() of the file to play first (eg.: the last one played), 0 for any
+int music_init(uint start_track)
 {
   if (!dir_exists(psp_music_folder)) return -1;
   SceUID dir = sceIoDopen(psp_music_folder);
   if (dir < 0) return -1;
 
   SceIoDirent d_dir;
+
+  // Only names are listed here, files are probed on the music thread right before they play
   while ( sceIoDread(dir, &d_dir) > 0 )
   {
     // Is a MP3 file?
-    if ( str_endswith(d_dir.d_name, ".mp3") )
-    {
-      music_playlist_append(&current_playlist, d_dir.d_name, strlen(d_dir.d_name));
-    }
+    if ( !str_endswith(d_dir.d_name, ".mp3") ) continue;
+
+    music_playlist_append(&current_playlist, d_dir.d_name, strlen(d_dir.d_name));
   }
   sceIoDclose(dir);
 
@@ -100,11 +110,176 @@ int music_init()
   if (music_init_modules() < 0) return -1;
 
   music_shuffle_playlist();
-  return 0;
+
+  // Move it to the front of the shuffled order
+  for ( int i = 0; start_track && i < current_playlist.size; i++ )
+  {
+    int track = current_playlist_order[i];
+    if ( music_track_hash(track) != start_track ) continue;
+
+    current_playlist_order[i] = current_playlist_order[0];
+    current_playlist_order[0] = track;
+    break;
+  }
+
+  return music_thread_start();
+}
+
+/* Identifies a playlist file by its name, 0 if there's no such track
+ * Its index changes whenever files are added or removed, this doesn't
+ */
+uint music_track_hash(int track)
+{
+  if ( track < 0 || track >= current_playlist.size ) return 0;
+
+  return str_hash(current_playlist.file_path[track]);
 }
 
-cbool music_thread_playing = FALSE;
-cbool player_skipped_song = FALSE;
+// Commands from the UI, only the music thread plays anything
+static music_cmd music_cmds_buf[MUSIC_CMD_QUEUE_SIZE];
+static spsc_ring music_cmds;
+static SceUID music_cmd_evflag = -1;
+
+// UI side, what was asked last (the music thread may not be there yet)
+static uint music_cmd_sent = 0;
+static cbool music_cmd_enabled = FALSE;
+
+// Music thread side
+static cbool music_enabled_state = FALSE;
+static cbool music_interrupted = FALSE;
+static cbool music_quit = FALSE;
+static cbool music_skipped = FALSE;
+static int music_volume = PSP_AUDIO_VOLUME_MAX;
+static uint music_cmd_done = 0;
+
+// Published by the music thread, read with music_get_status()
+static music_status music_status_shared;
+static volatile uint music_status_seq = 0;
+
+static void music_status_publish(cbool playing)
+{
+  // Odd while being written
+  music_status_seq++;
+  __sync_synchronize();
+
+  music_status_shared.enabled = music_enabled_state;
+  music_status_shared.playing = playing;
+  music_status_shared.track = current_playlist_order[current_song_index];
+  music_status_shared.volume = music_volume;
+  music_status_shared.cmd_done = music_cmd_done;
+
+  __sync_synchronize();
+  music_status_seq++;
+}
+
+void music_get_status(music_status* out)
+{
+  if (!out) return;
+
+  uint seq;
+
+  do
+  {
+    seq = music_status_seq;
+    __sync_synchronize();
+    *out = music_status_shared;
+    __sync_synchronize();
+  } while ( (seq & 1) || seq != music_status_seq );
+}
+
+// Never blocks, returns FALSE if the queue is full
+cbool music_cmd_send(uchar type, int arg)
+{
+  if (music_cmd_evflag < 0) return FALSE;
+
+  music_cmd cmd = { .type = type, .arg = arg, .id = music_cmd_sent + 1 };
+
+  if ( !spsc_ring_push(&music_cmds, &cmd) ) return FALSE;
+
+  music_cmd_sent = cmd.id;
+  if (type == MUSIC_CMD_PLAY) music_cmd_enabled = TRUE;
+  else if (type == MUSIC_CMD_STOP) music_cmd_enabled = FALSE;
+
+  sceKernelSetEventFlag(music_cmd_evflag, 1);
+  return TRUE;
+}
+
+// Is music on, as far as the UI is concerned
+cbool music_enabled()
+{
+  if (music_cmd_evflag < 0) return FALSE;
+
+  music_status status;
+  music_get_status(&status);
+
+  // Still on its way to the music thread
+  if (status.cmd_done != music_cmd_sent) return music_cmd_enabled;
+
+  return status.enabled;
+}
+
+static void music_next_track(cbool back)
+{
+  if (back)
+  {
+    current_song_index--;
+    if (current_song_index < 0) current_song_index = 0;
+  }
+  else
+  {
+    current_song_index++;
+
+    // Loop through playlist again, player has played all mp3 music available
+    if (current_song_index >= current_playlist.size)
+    {
+      current_song_index = 0;
+      music_shuffle_playlist();
+    }
+  }
+}
+
+// Music thread, a burst of skips only moves the track index
+static void music_process_cmds()
+{
+  music_cmd cmd;
+
+  while ( spsc_ring_pop(&music_cmds, &cmd) )
+  {
+    switch (cmd.type)
+    {
+      case MUSIC_CMD_PLAY:
+        music_enabled_state = TRUE;
+        break;
+
+      case MUSIC_CMD_STOP:
+        music_enabled_state = FALSE;
+        music_interrupted = TRUE;
+        break;
+
+      case MUSIC_CMD_NEXT:
+      case MUSIC_CMD_PREV:
+        if (!music_enabled_state) break;
+        music_next_track(cmd.type == MUSIC_CMD_PREV);
+        music_interrupted = TRUE;
+        music_skipped = TRUE;
+        break;
+
+      case MUSIC_CMD_VOLUME:
+        music_volume = cmd.arg < 0 ? 0 : (cmd.arg > PSP_AUDIO_VOLUME_MAX ? PSP_AUDIO_VOLUME_MAX : cmd.arg);
+        break;
+
+      case MUSIC_CMD_QUIT:
+        music_enabled_state = FALSE;
+        music_interrupted = TRUE;
+        music_quit = TRUE;
+        break;
+    }
+
+    music_cmd_done = cmd.id;
+  }
+
+  music_status_publish(music_enabled_state && !music_interrupted);
+}
 
 // Input and Output buffers
 unsigned char	mp3_buf[16*1024]  __attribute__((aligned(64)));
@@ -135,63 +310,171 @@ int music_mp3_fill_stream_buf( int fd, int handle )
 	return pos > 0;
 }
 
-int music_mp3_thread_end(cbool release_audio, int channel, cbool release_handle, int handle, cbool term_resource, cbool close_file, SceUID fd)
+/* Where the audio is in the file, past the tags at either end
+ * sceMp3 doesn't have to read through them, and tag data that looks like frames can make sceMp3Init() fail
+ * Uses mp3_buf, only before it's given to sceMp3
+ */
+static int music_mp3_stream_range(SceUID fd, uint* start, uint* end, const byte** head, uint* head_len)
 {
-  if (release_audio && channel >= 0) sceAudioSRCChRelease();
-  if (release_handle) sceMp3ReleaseMp3Handle(handle);
-  if (term_resource) sceMp3TermResource();
-  if (close_file) sceIoClose(fd);
-  music_thread_playing = FALSE;
+  int file_size = sceIoLseek32(fd, 0, SEEK_END);
+  if (file_size <= 0) return -1;
+
+  *start = 0;
+  *end = file_size;
 
-  // Automatic Song Skip after it ends
-  if (app_play_music && !player_skipped_song)
+  if ( file_size >= MP3_TRAILER_PROBE_SIZE && sceIoLseek32(fd, file_size - MP3_TRAILER_PROBE_SIZE, SEEK_SET) >= 0 &&
+       sceIoRead(fd, mp3_buf, MP3_TRAILER_PROBE_SIZE) == MP3_TRAILER_PROBE_SIZE )
   {
-    music_play_random(FALSE);
+    uint trailer = mp3_trailer_size(mp3_buf, MP3_TRAILER_PROBE_SIZE);
+    if (trailer < *end) *end -= trailer;
   }
-  // If player skipped song
-  else if (player_skipped_song)
+
+  int read;
+
+  // Some files have more than one ID3v2 tag in a row, only their headers are read
+  while ( TRUE )
   {
-    player_skipped_song = FALSE;
+    if ( *start >= *end || sceIoLseek32(fd, *start, SEEK_SET) < 0 ) return -1;
+
+    read = sceIoRead(fd, mp3_buf, MP3_PROBE_SIZE);
+    if (read <= 0) return -1;
+
+    uint tag = mp3_id3v2_size(mp3_buf, read);
+    if (tag == 0) break;
+
+    *start += tag;
   }
 
-  sceKernelExitDeleteThread(0);
+  // Padding or junk can come after the tags, searched a chunk at a time
+  // Chunks overlap by 3 bytes, so a header split between two is still found
+  uint pos = *start;
+
+  while ( TRUE )
+  {
+    int offset = mp3_frame_find(mp3_buf, read, NULL);
+
+    if (offset >= 0)
+    {
+      *start = pos + offset;
+
+      // Read again from the frame, for its Xing / VBRI header
+      if ( offset > 0 && sceIoLseek32(fd, *start, SEEK_SET) >= 0 )
+      {
+        read = sceIoRead(fd, mp3_buf, MP3_PROBE_SIZE);
+        offset = 0;
+        if (read < 4) break;
+      }
+
+      *head = mp3_buf + offset;
+      *head_len = read - offset;
+      return 0;
+    }
+
+    if ( read < MP3_PROBE_SIZE || pos + read - *start >= MP3_SEARCH_LIMIT ) break;
+
+    pos += read - 3;
+    if ( sceIoLseek32(fd, pos, SEEK_SET) < 0 ) break;
+
+    read = sceIoRead(fd, mp3_buf, MP3_PROBE_SIZE);
+    if (read < 4) break;
+  }
+
+  // No frame found, nothing is known about the audio
+  *head = NULL;
+  *head_len = 0;
 
   return 0;
 }
 
-int music_mp3_player_thread(SceSize args, void* argp)
+/* Reads the tags' headers and the first frame, only a few KiB per file
+ * Files whose first frame isn't found are kept with nothing known about them, sceMp3Init() decides
+ * Uses mp3_buf, so only before it's given to sceMp3
+ */
+static int music_mp3_probe(SceUID fd, mp3_info* info)
 {
-  if ( args < 1 || !argp )
+  const byte* head;
+  uint head_len;
+
+  if ( music_mp3_stream_range(fd, &info->stream_start, &info->stream_end, &head, &head_len) < 0 ) return -1;
+
+  if (!head)
   {
-    music_mp3_thread_end(FALSE, 0, FALSE, 0, FALSE, FALSE, 0);
-    return -1;
+    uint stream_start = info->stream_start, stream_end = info->stream_end;
+
+    memset(info, 0, sizeof(mp3_info));
+    info->stream_start = stream_start;
+    info->stream_end = stream_end;
+
+    return 0;
   }
 
-  char** music_path = argp;
+  if ( mp3_info_parse(head, head_len, info) < 0 ) return -1;
+
+  // sceMp3 only decodes MPEG 1 and 2 layer III
+  if (info->frame.version == MP3_MPEG25) return -1;
+
+  return 0;
+}
+
+int music_mp3_play_end(cbool release_audio, int channel, cbool release_handle, int handle, cbool term_resource, cbool close_file, SceUID fd)
+{
+  if (release_audio && channel >= 0) sceAudioSRCChRelease();
+  if (release_handle) sceMp3ReleaseMp3Handle(handle);
+  if (term_resource) sceMp3TermResource();
+  if (close_file) sceIoClose(fd);
+
+  return 0;
+}
+
+/* Plays a whole file on the music thread
+ * Returns early if a command interrupted it, < 0 if it couldn't be played
+ */
+int music_mp3_play(const char* music_path)
+{
+  if ( !music_path ) return -1;
 
   // Get Music Full Path
   char music_full_path[PATH_MAX];
-  snprintf(music_full_path, sizeof(music_full_path), "%s%s", psp_music_folder, *music_path);
-
-  sceKernelPrintf("Playing: '%s'", music_full_path);
+  snprintf(music_full_path, sizeof(music_full_path), "%s%s", psp_music_folder, music_path);
 
   // Open the input file
 	int fd = sceIoOpen( music_full_path, PSP_O_RDONLY, 0777 );
 	if (fd < 0)
   {
-    music_mp3_thread_end(FALSE, 0, FALSE, 0, FALSE, FALSE, 0);
     return -1;
   }
 
+  // Only the file about to play is probed, so a big library doesn't slow down startup
+  mp3_info probed;
+  const mp3_info* info = &probed;
+
+  if ( music_mp3_probe(fd, &probed) < 0 )
+  {
+    sceKernelPrintf("Skipping: '%s'", music_full_path);
+    music_mp3_play_end(FALSE, 0, FALSE, 0, FALSE, TRUE, fd);
+    return -1;
+  }
+
+  if (info->frame.sample_rate)
+  {
+    sceKernelPrintf("Playing: '%s' (%u:%02u, %u Hz, %u kbit/s)", music_full_path,
+                    info->duration / 60000, info->duration / 1000 % 60, info->frame.sample_rate, info->bitrate);
+  }
+  else
+  {
+    sceKernelPrintf("Playing: '%s'", music_full_path);
+  }
+
 	if ( sceMp3InitResource() < 0 )
   {
-    music_mp3_thread_end(FALSE, 0, FALSE, 0, FALSE, TRUE, fd);
+    music_mp3_play_end(FALSE, 0, FALSE, 0, FALSE, TRUE, fd);
     return -1;
   }
 
+  // Tags were already found when probing
   SceMp3InitArg mp3Init;
-	mp3Init.mp3StreamStart = 0;
-	mp3Init.mp3StreamEnd = sceIoLseek32( fd, 0, SEEK_END );
+	mp3Init.mp3StreamStart = info->stream_start;
+	mp3Init.mp3StreamEnd = info->stream_end;
 	mp3Init.mp3Buf = mp3_buf;
 	mp3Init.mp3BufSize = sizeof(mp3_buf);
 	mp3Init.pcmBuf = pcm_buf;
@@ -201,13 +484,13 @@ int music_mp3_player_thread(SceSize args, void* argp)
 
   if ( handle < 0 )
   {
-    music_mp3_thread_end(FALSE, 0, FALSE, 0, TRUE, TRUE, fd);
+    music_mp3_play_end(FALSE, 0, FALSE, 0, TRUE, TRUE, fd);
     return -1;
   }
 
   if ( music_mp3_fill_stream_buf( fd, handle ) < 0 )
   {
-    music_mp3_thread_end(FALSE, 0, TRUE, handle, TRUE, TRUE, fd);
+    music_mp3_play_end(FALSE, 0, TRUE, handle, TRUE, TRUE, fd);
     return -1;
   }
 
@@ -218,26 +501,49 @@ int music_mp3_player_thread(SceSize args, void* argp)
   // According to Hrydgard: "It's simply not implemented."
   if ( sceMp3Init( handle ) < 0 )
   {
-    music_mp3_thread_end(FALSE, 0, TRUE, handle, TRUE, TRUE, fd);
+    music_mp3_play_end(FALSE, 0, TRUE, handle, TRUE, TRUE, fd);
     return -1;
   }
 
-  int channel = -1;
-  int volume = PSP_AUDIO_VOLUME_MAX;
 	int samplingRate = sceMp3GetSamplingRate( handle );
 	int numChannels = sceMp3GetMp3ChannelNum( handle );
-	int lastDecoded = 0;
+
+  // Frame length is known from the probe (if it found a frame), so the channel is reserved once, before decoding
+  int channel = info->frame.samples ? sceAudioSRCChReserve(info->frame.samples, samplingRate, numChannels) : -1;
+	int lastDecoded = channel >= 0 ? info->frame.samples * 2 * numChannels : 0;
 
   // If you don't set the looping amount to 0, it will keep looping forever (why Sony)
   sceMp3SetLoopNum(handle, 0);
 
-  music_thread_playing = TRUE;
+  music_status_publish(TRUE);
+
+  // Volume is applied here, the hardware channel always plays at max
+  mixer_gain gain;
+  mixer_gain_init(&gain, 0);
+  mixer_gain_ramp(&gain, music_volume, MUSIC_FADE_IN * samplingRate / 1000);
 
-  // Little pause before playing song
-  // sceKernelDelayThread(1e6 * 0.5f);
+  cbool fading_out = FALSE;
 
-  while (music_thread_playing && app_play_music)
+  while ( TRUE )
   {
+    // Stop, skip or quit
+    if ( !spsc_ring_empty(&music_cmds) ) music_process_cmds();
+
+    // Fade out before actually stopping
+    if (music_interrupted && !fading_out)
+    {
+      if (channel < 0 || music_quit) break;
+      mixer_gain_ramp(&gain, 0, MUSIC_FADE_OUT * samplingRate / 1000);
+      fading_out = TRUE;
+    }
+
+    if (fading_out && !mixer_gain_ramping(&gain)) break;
+
+    if (!fading_out && gain.target != music_volume)
+    {
+      mixer_gain_ramp(&gain, music_volume, MUSIC_VOLUME_RAMP * samplingRate / 1000);
+    }
+
     // If more data is needed, fill stream buffer
     if (sceMp3CheckStreamDataNeeded(handle) > 0) music_mp3_fill_stream_buf(fd, handle);
 
@@ -256,38 +562,107 @@ int music_mp3_player_thread(SceSize args, void* argp)
       if (channel >= 0) sceAudioSRCChRelease();
       channel = sceAudioSRCChReserve(bytesDecoded / (2 * numChannels), samplingRate, numChannels);
     }
-    sceAudioSRCOutputBlocking( volume, buf );
+    mixer_gain_apply(&gain, buf, bytesDecoded / (2 * numChannels), numChannels);
+    sceAudioSRCOutputBlocking( PSP_AUDIO_VOLUME_MAX, buf );
     lastDecoded = bytesDecoded;
   }
 
-  music_mp3_thread_end(TRUE, channel, TRUE, handle, TRUE, TRUE, fd);
+  music_mp3_play_end(TRUE, channel, TRUE, handle, TRUE, TRUE, fd);
   return 0;
 }
 
-SceUID mp3_play_thid = -1;
-
-int music_play(char* music_path)
+static int music_thread(SceSize args, void* argp)
 {
-  // Don't play if music wasn't found
-  if (!music_path || current_playlist.size <= 0) return -1;
+  // -Wextra
+  (void)args; (void)argp;
 
-  // If user skipped song, stop playing the current one
-  if (music_thread_playing)
+  int failed = 0;
+
+  while ( !music_quit )
   {
-    music_stop();
-  }
+    // Nothing to play, sleep until the UI asks for something
+    if ( !music_enabled_state )
+    {
+      sceKernelWaitEventFlag(music_cmd_evflag, 1, PSP_EVENT_WAITOR | PSP_EVENT_WAITCLEAR, NULL, NULL);
+    }
+
+    music_process_cmds();
+
+    // Don't open every song of a burst of skips, only the one it ends on
+    while ( music_skipped && !music_quit )
+    {
+      SceUInt timeout = MUSIC_SKIP_SETTLE;
+
+      music_skipped = FALSE;
 
-  mp3_play_thid = sceKernelCreateThread("MP3 Player", music_mp3_player_thread, 0x11, 0x2000, 0, NULL);
-  if (mp3_play_thid < 0) return -1;
+      // The play loop polls the ring, so the flag may still be set by commands already handled
+      // Anything sent after clearing it sets it again, and the ring is checked after that
+      sceKernelClearEventFlag(music_cmd_evflag, ~1);
 
-  int res = sceKernelStartThread(mp3_play_thid, sizeof(char**), &music_path);
-  if (res < 0) return -1;
+      if ( spsc_ring_empty(&music_cmds) &&
+           sceKernelWaitEventFlag(music_cmd_evflag, 1, PSP_EVENT_WAITOR | PSP_EVENT_WAITCLEAR, NULL, &timeout) < 0 )
+      {
+        continue;
+      }
+
+      music_process_cmds();
+    }
+
+    music_interrupted = FALSE;
+
+    if ( !music_enabled_state ) continue;
+
+    int track = current_playlist_order[current_song_index];
+    int res = music_mp3_play(current_playlist.file_path[track]);
+
+    // Every song failed, give up instead of looping forever
+    failed = res < 0 ? failed + 1 : 0;
+    if ( failed >= current_playlist.size )
+    {
+      failed = 0;
+      music_enabled_state = FALSE;
+    }
+
+    // Automatic Song Skip after it ends
+    if ( !music_interrupted && music_enabled_state )
+    {
+      music_next_track(FALSE);
+    }
+
+    music_status_publish(FALSE);
+  }
 
   return 0;
 }
 
-static int current_playlist_order[MUSIC_PLAYLIST_SIZE];
-static int current_song_index = 0;
+static SceUID music_thid = -1;
+
+static int music_thread_start()
+{
+  spsc_ring_init(&music_cmds, music_cmds_buf, sizeof(music_cmd), MUSIC_CMD_QUEUE_SIZE);
+  music_status_publish(FALSE);
+
+  music_cmd_evflag = sceKernelCreateEventFlag("Music Event Flag", 0, 0, NULL);
+  if (music_cmd_evflag < 0) return -1;
+
+  music_thid = sceKernelCreateThread("MP3 Player", music_thread, 0x11, 0x2000, 0, NULL);
+
+  if ( music_thid >= 0 && sceKernelStartThread(music_thid, 0, NULL) < 0 )
+  {
+    sceKernelDeleteThread(music_thid);
+    music_thid = -1;
+  }
+
+  // Without the thread, nobody would ever read the commands
+  if (music_thid < 0)
+  {
+    sceKernelDeleteEventFlag(music_cmd_evflag);
+    music_cmd_evflag = -1;
+    return -1;
+  }
+
+  return 0;
+}
 
 void music_shuffle_playlist()
 {
@@ -309,43 +684,28 @@ void music_shuffle_playlist()
   }
 }
 
-void music_play_random(cbool back)
+int music_end()
 {
-  // Don't play if music wasn't found
-  if (current_playlist.size <= 0) return;
-
-  // Loop through playlist again, player has played all mp3 music available
-  if (current_song_index >= current_playlist.size)
+  // Waits for the music thread to stop playing (only when exiting)
+  if (music_thid >= 0)
   {
-    current_song_index = 0;
-    music_shuffle_playlist();
+    if ( !music_cmd_send(MUSIC_CMD_QUIT, 0) )
+    {
+      music_quit = TRUE;
+      sceKernelSetEventFlag(music_cmd_evflag, 1);
+    }
+
+    sceKernelWaitThreadEnd(music_thid, NULL);
+    sceKernelDeleteThread(music_thid);
+    music_thid = -1;
   }
 
-  // Go back to previous song
-  if (back)
+  if (music_cmd_evflag >= 0)
   {
-    current_song_index -= 2;
-    if (current_song_index < 0) current_song_index = 0;
+    sceKernelDeleteEventFlag(music_cmd_evflag);
+    music_cmd_evflag = -1;
   }
 
-  char* music = current_playlist.file_path[current_playlist_order[current_song_index]];
-
-  music_play(music);
-  current_song_index++;
-}
-
-int music_stop()
-{
-  // Stop playing music and wait until music thread ends
-  music_thread_playing = FALSE;
-  sceKernelWaitThreadEnd(mp3_play_thid, NULL);
-
-  return 0;
-}
-
-int music_end()
-{
-  app_play_music = FALSE;
   music_end_modules();
   music_playlist_clear(&current_playlist);
   return 0;
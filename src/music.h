@@ -31,15 +31,55 @@ typedef struct
     uint size;
 } music_playlist;
 
+// Must be a power of 2
+#define MUSIC_CMD_QUEUE_SIZE 32
+
+// A new song is only opened after skips stop for this long (in us)
+#define MUSIC_SKIP_SETTLE 250000
+
+// Software gain ramps (in ms), instead of cutting the sound
+#define MUSIC_FADE_IN 400
+#define MUSIC_FADE_OUT 60
+#define MUSIC_VOLUME_RAMP 30
+
+// Up / Down change the volume by this much (PSP_AUDIO_VOLUME_MAX is 0x8000)
+#define MUSIC_VOLUME_STEP 0x1000
+
+enum
+{
+  MUSIC_CMD_PLAY,
+  MUSIC_CMD_STOP,
+  MUSIC_CMD_NEXT,
+  MUSIC_CMD_PREV,
+  MUSIC_CMD_VOLUME, // arg: 0 - PSP_AUDIO_VOLUME_MAX
+  MUSIC_CMD_QUIT,
+};
+
+typedef struct
+{
+  uchar type;
+  int arg;
+  uint id;
+} music_cmd;
+
+// Snapshot of the music thread's state
+typedef struct
+{
+  cbool enabled;
+  cbool playing;
+  int track; // Playlist file, not the position in the shuffled order
+  int volume;
+  uint cmd_done; // id of the last command handled
+} music_status;
+
 extern music_playlist current_playlist;
-extern cbool music_thread_playing;
-extern cbool player_skipped_song;
-extern SceUID mp3_play_thid;
 
-int music_init();
-int music_stop();
+int music_init(uint start_track);
+uint music_track_hash(int track);
 int music_end();
-void music_play_random(cbool back);
+cbool music_cmd_send(uchar type, int arg);
+cbool music_enabled();
+void music_get_status(music_status* out);
 void music_shuffle_playlist();
 
 
@@ -0,0 +1,71 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "ring.h"
+
+void spsc_ring_init(spsc_ring* ring, void* buf, uint elem_size, uint size)
+{
+  if (!ring) return;
+
+  ring->head = 0;
+  ring->tail = 0;
+  ring->size = size;
+  ring->elem_size = elem_size;
+  ring->buf = buf;
+}
+
+// Producer side, returns FALSE if the ring is full
+cbool spsc_ring_push(spsc_ring* ring, const void* elem)
+{
+  uint head = ring->head;
+
+  if (head - ring->tail >= ring->size) return FALSE;
+
+  memcpy(ring->buf + (head & (ring->size - 1)) * ring->elem_size, elem, ring->elem_size);
+
+  // Element must be written before it's published
+  __sync_synchronize();
+  ring->head = head + 1;
+
+  return TRUE;
+}
+
+// Consumer side, returns FALSE if the ring is empty
+cbool spsc_ring_pop(spsc_ring* ring, void* out)
+{
+  uint tail = ring->tail;
+
+  if (ring->head == tail) return FALSE;
+
+  // Element must be read after head was
+  __sync_synchronize();
+  memcpy(out, ring->buf + (tail & (ring->size - 1)) * ring->elem_size, ring->elem_size);
+
+  __sync_synchronize();
+  ring->tail = tail + 1;
+
+  return TRUE;
+}
+
+cbool spsc_ring_empty(const spsc_ring* ring)
+{
+  return ring->head == ring->tail;
+}
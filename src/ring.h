@@ -0,0 +1,42 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RING_H_
+#define RING_H_
+
+#include "utils.h"
+
+/* Single producer / single consumer ring buffer
+ * Lock-free: only the producer writes head, only the consumer writes tail
+ */
+typedef struct
+{
+  volatile uint head;
+  volatile uint tail;
+  uint size; // Power of 2
+  uint elem_size;
+  byte* buf;
+} spsc_ring;
+
+void spsc_ring_init(spsc_ring* ring, void* buf, uint elem_size, uint size);
+cbool spsc_ring_push(spsc_ring* ring, const void* elem);
+cbool spsc_ring_pop(spsc_ring* ring, void* out);
+cbool spsc_ring_empty(const spsc_ring* ring);
+
+#endif /* RING_H_ */
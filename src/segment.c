@@ -0,0 +1,142 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "lib/glib2d/glib2d.h"
+#include "tex.h"
+#include "segment.h"
+
+enum
+{
+  // Seven segment digits
+  SEG_A, SEG_B, SEG_C, SEG_D, SEG_E, SEG_F, SEG_G,
+
+  SEG_COLON_TOP, SEG_COLON_BOTTOM,
+  SEG_DOT,
+  SEG_ALARM,
+
+  SEG_NOTE_STEM, SEG_NOTE_FLAG, SEG_NOTE_HEAD,
+
+  SEG_BAT_TOP, SEG_BAT_BOTTOM, SEG_BAT_LEFT, SEG_BAT_RIGHT, SEG_BAT_TIP,
+  SEG_BAT_BAR1, SEG_BAT_BAR2, SEG_BAT_BAR3, SEG_BAT_BAR4,
+
+  SEG_COUNT
+};
+
+/*    A
+ *  F   B
+ *    G
+ *  E   C
+ *    D
+ */
+const segment_rect segment_rects[SEG_COUNT] =
+{
+  [SEG_A] = {  4.0f,  2.0f,  8.0f,  3.0f },
+  [SEG_B] = { 12.0f,  4.0f,  3.0f, 11.0f },
+  [SEG_C] = { 12.0f, 17.0f,  3.0f, 11.0f },
+  [SEG_D] = {  4.0f, 27.0f,  8.0f,  3.0f },
+  [SEG_E] = {  1.0f, 17.0f,  3.0f, 11.0f },
+  [SEG_F] = {  1.0f,  4.0f,  3.0f, 11.0f },
+  [SEG_G] = {  4.0f, 14.5f,  8.0f,  3.0f },
+
+  [SEG_COLON_TOP]    = { 6.5f,  9.0f, 3.0f, 3.0f },
+  [SEG_COLON_BOTTOM] = { 6.5f, 20.0f, 3.0f, 3.0f },
+  [SEG_DOT]          = { 6.5f, 27.0f, 3.0f, 3.0f },
+  [SEG_ALARM]        = { 5.0f, 13.0f, 6.0f, 6.0f },
+
+  [SEG_NOTE_STEM] = {  9.0f,  6.0f, 2.0f, 18.0f },
+  [SEG_NOTE_FLAG] = { 11.0f,  6.0f, 4.0f,  3.0f },
+  [SEG_NOTE_HEAD] = {  4.0f, 21.0f, 7.0f,  5.0f },
+
+  [SEG_BAT_TOP]    = {  2.0f,  6.0f, 12.0f,  2.0f },
+  [SEG_BAT_BOTTOM] = {  2.0f, 26.0f, 12.0f,  2.0f },
+  [SEG_BAT_LEFT]   = {  2.0f,  6.0f,  2.0f, 22.0f },
+  [SEG_BAT_RIGHT]  = { 12.0f,  6.0f,  2.0f, 22.0f },
+  [SEG_BAT_TIP]    = {  6.0f,  4.0f,  4.0f,  2.0f },
+  [SEG_BAT_BAR1]   = {  5.0f, 21.5f,  6.0f,  3.0f },
+  [SEG_BAT_BAR2]   = {  5.0f, 17.5f,  6.0f,  3.0f },
+  [SEG_BAT_BAR3]   = {  5.0f, 13.5f,  6.0f,  3.0f },
+  [SEG_BAT_BAR4]   = {  5.0f,  9.5f,  6.0f,  3.0f },
+};
+
+#define S(seg) (1u << SEG_##seg)
+
+#define SEG_BAT (S(BAT_TOP) | S(BAT_BOTTOM) | S(BAT_LEFT) | S(BAT_RIGHT) | S(BAT_TIP))
+
+// Lit segments for each texture they replace
+const uint segment_glyphs[T_COUNT] =
+{
+  [T_ZERO]  = S(A) | S(B) | S(C) | S(D) | S(E) | S(F),
+  [T_ONE]   = S(B) | S(C),
+  [T_TWO]   = S(A) | S(B) | S(G) | S(E) | S(D),
+  [T_THREE] = S(A) | S(B) | S(G) | S(C) | S(D),
+  [T_FOUR]  = S(F) | S(G) | S(B) | S(C),
+  [T_FIVE]  = S(A) | S(F) | S(G) | S(C) | S(D),
+  [T_SIX]   = S(A) | S(F) | S(G) | S(E) | S(C) | S(D),
+  [T_SEVEN] = S(A) | S(B) | S(C),
+  [T_EIGHT] = S(A) | S(B) | S(C) | S(D) | S(E) | S(F) | S(G),
+  [T_NINE]  = S(A) | S(B) | S(C) | S(D) | S(F) | S(G),
+
+  [T_COLON]      = S(COLON_TOP) | S(COLON_BOTTOM),
+  [T_DASH]       = S(G),
+  [T_DOT_BOTTOM] = S(DOT),
+  [T_ICON_MUSIC] = S(NOTE_STEM) | S(NOTE_FLAG) | S(NOTE_HEAD),
+  [T_ALARM_DOT]  = S(ALARM),
+
+  [T_BAT_FULL]  = SEG_BAT | S(BAT_BAR1) | S(BAT_BAR2) | S(BAT_BAR3) | S(BAT_BAR4),
+  [T_BAT_3BAR]  = SEG_BAT | S(BAT_BAR1) | S(BAT_BAR2) | S(BAT_BAR3),
+  [T_BAT_2BAR]  = SEG_BAT | S(BAT_BAR1) | S(BAT_BAR2),
+  [T_BAT_1BAR]  = SEG_BAT | S(BAT_BAR1),
+  [T_BAT_EMPTY] = SEG_BAT,
+};
+
+/* Draws glyph (T_*) centered at pos, as one batch of untextured sprites
+ * Same arguments as tex_draw(), needs no texture memory at all
+ */
+int segment_draw(int glyph, const ScePspFVector2* pos, const ScePspFVector2* size, g2dColor color)
+{
+  if ( glyph < 0 || glyph >= T_COUNT || !pos || !size || G2D_GET_A(color) == 0 )
+  {
+    return -1;
+  }
+
+  uint segs = segment_glyphs[glyph];
+  float unit_x = size->x / SEGMENT_GRID_W;
+  float unit_y = size->y / SEGMENT_GRID_H;
+  float x0 = pos->x - size->x / 2.0f;
+  float y0 = pos->y - size->y / 2.0f;
+
+  g2dBeginRects(NULL);
+  g2dSetCoordMode(G2D_UP_LEFT);
+  g2dSetColor(color);
+
+  for ( int seg = 0; segs; seg++, segs >>= 1 )
+  {
+    if ( !(segs & 1) ) continue;
+
+    const segment_rect* r = &segment_rects[seg];
+
+    g2dSetCoordXY(x0 + r->x * unit_x, y0 + r->y * unit_y);
+    g2dSetScaleWH(r->w * unit_x, r->h * unit_y);
+    g2dAdd();
+  }
+
+  g2dEnd();
+
+  return 0;
+}
@@ -0,0 +1,44 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEGMENT_H_
+#define SEGMENT_H_
+
+#include <psptypes.h>
+
+#include "lib/glib2d/glib2d.h"
+#include "utils.h"
+
+// Segments are laid out on a grid of this many units, stretched to whatever size is drawn
+#define SEGMENT_GRID_W 16.0f
+#define SEGMENT_GRID_H 32.0f
+
+// Rectangle in grid units
+typedef struct
+{
+  float x, y;
+  float w, h;
+} segment_rect;
+
+extern const segment_rect segment_rects[];
+extern const uint segment_glyphs[];
+
+int segment_draw(int glyph, const ScePspFVector2* pos, const ScePspFVector2* size, g2dColor color);
+
+#endif /* SEGMENT_H_ */
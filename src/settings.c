@@ -0,0 +1,160 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <pspkernel.h>
+#include <pspiofilemgr.h>
+#include <pspaudio.h>
+#include <string.h>
+
+#include "settings.h"
+
+app_settings settings;
+
+// How many times settings were written to the Memory Stick
+uint settings_writes = 0;
+
+// Last written / read from SETTINGS_FILE
+static app_settings settings_saved;
+
+// Last seen by settings_update(), and since when
+static app_settings settings_pending;
+static uint settings_pending_time = 0;
+
+void settings_defaults(app_settings* s)
+{
+  // Padding is part of the checksum
+  memset(s, 0, sizeof(app_settings));
+
+  s->color = 0;
+  s->brightness = 0;
+  s->music_on = FALSE;
+  s->alarms_armed = TRUE;
+  s->animations = TRUE;
+  s->track = 0;
+  s->volume = PSP_AUDIO_VOLUME_MAX;
+}
+
+// FNV-1a
+uint settings_checksum(const app_settings* s)
+{
+  const byte* data = (const byte*)s;
+  uint hash = 2166136261u;
+
+  for ( uint i = 0; i < sizeof(app_settings); i++ )
+  {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+
+  return hash;
+}
+
+void settings_encode(const app_settings* s, settings_file* out)
+{
+  memset(out, 0, sizeof(settings_file));
+
+  out->magic = SETTINGS_MAGIC;
+  out->version = SETTINGS_VERSION;
+  out->size = sizeof(app_settings);
+  out->data = *s;
+  out->checksum = settings_checksum(&out->data);
+}
+
+/* Checks a settings file read from the Memory Stick
+ * Returns < 0 (out is left alone) if it's from another version or corrupt
+ */
+int settings_decode(const settings_file* file, app_settings* out)
+{
+  if ( file->magic != SETTINGS_MAGIC || file->version != SETTINGS_VERSION || file->size != sizeof(app_settings) ) return -1;
+  if ( file->checksum != settings_checksum(&file->data) ) return -1;
+
+  app_settings s = file->data;
+
+  // Out of range values are reset, the rest is kept
+  if ( s.music_on > TRUE ) s.music_on = FALSE;
+  if ( s.alarms_armed > TRUE ) s.alarms_armed = TRUE;
+  if ( s.volume < 0 || s.volume > PSP_AUDIO_VOLUME_MAX ) s.volume = PSP_AUDIO_VOLUME_MAX;
+
+  *out = s;
+  return 0;
+}
+
+// Defaults are used if the file is missing or corrupt
+int settings_load(void)
+{
+  settings_defaults(&settings);
+
+  settings_file file;
+  int res = -1;
+
+  SceUID fd = sceIoOpen(SETTINGS_FILE, PSP_O_RDONLY, 0777);
+
+  if ( fd >= 0 )
+  {
+    if ( sceIoRead(fd, &file, sizeof(file)) == sizeof(file) ) res = settings_decode(&file, &settings);
+    sceIoClose(fd);
+  }
+
+  settings_saved = settings;
+  settings_pending = settings;
+
+  return res;
+}
+
+// Writes settings right away, if they have changed
+int settings_save(void)
+{
+  if ( !memcmp(&settings, &settings_saved, sizeof(app_settings)) ) return 0;
+
+  settings_file file;
+  settings_encode(&settings, &file);
+
+  SceUID fd = sceIoOpen(SETTINGS_FILE, PSP_O_WRONLY | PSP_O_CREAT | PSP_O_TRUNC, 0777);
+  if (fd < 0) return -1;
+
+  int written = sceIoWrite(fd, &file, sizeof(file));
+  sceIoClose(fd);
+
+  if ( written != sizeof(file) ) return -1;
+
+  settings_writes++;
+  settings_saved = settings;
+  settings_pending = settings;
+
+  return 0;
+}
+
+/* Call every frame, settings are only written after they stop changing
+ * for SETTINGS_SAVE_DELAY, so the Memory Stick isn't written on every press
+ */
+void settings_update(void)
+{
+  uint now = sceKernelGetSystemTimeLow();
+
+  if ( memcmp(&settings, &settings_pending, sizeof(app_settings)) )
+  {
+    settings_pending = settings;
+    settings_pending_time = now;
+    return;
+  }
+
+  if ( now - settings_pending_time < SETTINGS_SAVE_DELAY ) return;
+
+  // Failing is not a big deal, it tries again later
+  if ( settings_save() < 0 ) settings_pending_time = now;
+}
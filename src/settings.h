@@ -0,0 +1,65 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include "utils.h"
+
+#define SETTINGS_FILE "settings.bin"
+
+#define SETTINGS_MAGIC 0x4B4C4344 // "DCLK"
+#define SETTINGS_VERSION 3
+
+// Only written once settings stop changing for this long (in us)
+#define SETTINGS_SAVE_DELAY 3000000
+
+typedef struct
+{
+  uchar color;       // Index into main()'s clock colors
+  uchar brightness;  // Index into main()'s brightness modes
+  cbool music_on;
+  cbool alarms_armed;
+  cbool animations;
+  uint track;        // str_hash() of the last playlist file's name, 0 if none
+  int volume;        // 0 - PSP_AUDIO_VOLUME_MAX
+} app_settings;
+
+// What's actually on the Memory Stick
+typedef struct
+{
+  uint magic;
+  uint version;
+  uint size;
+  app_settings data;
+  uint checksum;
+} settings_file;
+
+extern app_settings settings;
+extern uint settings_writes;
+
+void settings_defaults(app_settings* s);
+uint settings_checksum(const app_settings* s);
+int settings_decode(const settings_file* file, app_settings* out);
+void settings_encode(const app_settings* s, settings_file* out);
+int settings_load(void);
+int settings_save(void);
+void settings_update(void);
+
+#endif /* SETTINGS_H_ */
@@ -24,6 +24,8 @@
 #include "lib/glib2d/glib2d.h"
 #include "utils.h"
 #include "error.h"
+#include "anim.h"
+#include "segment.h"
 #include "tex.h"
 
 // All needed textures
@@ -56,6 +58,53 @@ union clock_tex main_clock_tex =
 
 struct clock_tex_draw curr_tex_draw = {0};
 
+// Time: 4 big digits (2 for hour and 2 for min), Date: 4 small ones (day and month)
+const struct clock_tex_layout clock_tex_layout =
+{
+  .time = { { 60.0f, 120.0f }, { 180.0f, 120.0f }, { 300.0f, 120.0f }, { 420.0f, 120.0f } },
+  .date = { { 360.0f, 240.0f }, { 390.0f, 240.0f }, { 420.0f, 240.0f }, { 450.0f, 240.0f } },
+};
+
+#define CLOCK_DIGITS(n)     { (n) / 10, (n) % 10, (n) < 10 }
+#define CLOCK_DIGITS_10(t)  CLOCK_DIGITS(t*10+0), CLOCK_DIGITS(t*10+1), CLOCK_DIGITS(t*10+2), CLOCK_DIGITS(t*10+3), CLOCK_DIGITS(t*10+4), \
+                            CLOCK_DIGITS(t*10+5), CLOCK_DIGITS(t*10+6), CLOCK_DIGITS(t*10+7), CLOCK_DIGITS(t*10+8), CLOCK_DIGITS(t*10+9)
+
+// Avoids divisions when building curr_tex_draw
+const clock_digits clock_digits_lut[100] =
+{
+  CLOCK_DIGITS_10(0), CLOCK_DIGITS_10(1), CLOCK_DIGITS_10(2), CLOCK_DIGITS_10(3), CLOCK_DIGITS_10(4),
+  CLOCK_DIGITS_10(5), CLOCK_DIGITS_10(6), CLOCK_DIGITS_10(7), CLOCK_DIGITS_10(8), CLOCK_DIGITS_10(9),
+};
+
+// Total time to load all textures, in us (including waiting for them)
+uint clock_tex_load_time = 0;
+
+int clock_glyphs = CLOCK_GLYPHS_TEXTURES;
+
+// Current time digits, composed on the GE (NULL if not composing)
+g2dTexture* clock_time_tex = NULL;
+static ScePspFVector2 clock_time_tex_origin = {0};
+static cbool clock_time_tex_dirty = TRUE;
+
+// Changed time digits: the old one slides down and fades out, the new one drops in from above
+static const anim_key clock_anim_out_y_keys[] = { { 0, 0.0f, ANIM_EASE_LINEAR }, { 250, CLOCK_TIME_ANIM_SLIDE, ANIM_EASE_IN } };
+static const anim_key clock_anim_out_a_keys[] = { { 0, 255.0f, ANIM_EASE_LINEAR }, { 200, 0.0f, ANIM_EASE_LINEAR } };
+static const anim_key clock_anim_in_y_keys[]  = { { 100, -CLOCK_TIME_ANIM_SLIDE, ANIM_EASE_LINEAR }, { 400, 0.0f, ANIM_EASE_OUT } };
+static const anim_key clock_anim_in_a_keys[]  = { { 100, 0.0f, ANIM_EASE_LINEAR }, { 350, 255.0f, ANIM_EASE_IN_OUT } };
+
+static const anim_track clock_anim_out_y = ANIM_TRACK(clock_anim_out_y_keys);
+static const anim_track clock_anim_out_a = ANIM_TRACK(clock_anim_out_a_keys);
+static const anim_track clock_anim_in_y  = ANIM_TRACK(clock_anim_in_y_keys);
+static const anim_track clock_anim_in_a  = ANIM_TRACK(clock_anim_in_a_keys);
+
+// What each time tile showed before it changed (NULL if nothing), bit per tile that's animating
+static app_tex* clock_time_anim_from[4] = {0};
+static uint clock_time_anim_tiles = 0;
+static cbool clock_time_anim_enabled = TRUE;
+static cbool clock_time_animating = FALSE;
+static uint clock_time_anim_start = 0;
+static uint clock_time_anim_elapsed = 0; // ms
+
 static const char* tex_filepath = "assets/textures/";
 
 int get_tex_full_path(const app_tex* tex, char* out, size_t size)
@@ -89,7 +138,8 @@ int app_tex_alloc(app_tex* tex)
     return ERROR_TEXTURES_NOT_FOUND;
   }
 
-  tex->tex = g2dTexLoad(tex_filepath, G2D_SWIZZLE);
+  // Digits double as the date, and icons are small too, both drawn at about a third of their size
+  tex->tex = g2dTexLoad(tex_filepath, G2D_SWIZZLE | G2D_MIPMAP);
 
   if ( !tex->tex )
   {
@@ -111,17 +161,98 @@ int app_tex_free(app_tex* tex)
   return 0;
 }
 
+static SceUID tex_load_thid = -1;
+static uint tex_load_start_time = 0;
+
+// Loads every texture in order
+static int tex_load_thread(SceSize args, void *argp)
+{
+  // -Wextra
+  (void)args; (void)argp;
+
+  for (int tex_i = 0; tex_i < T_COUNT; tex_i++)
+  {
+    app_tex* tex = &main_clock_tex.a[tex_i];
+    uint start_time = sceKernelGetSystemTimeLow();
+
+    tex->load_err = app_tex_alloc(tex);
+    tex->load_time = sceKernelGetSystemTimeLow() - start_time;
+  }
+
+  return 0;
+}
+
+/* Starts loading all textures on one background thread, Memory Stick reads and decoding overlap the rest of the init
+ * Decoding mallocs (libpng, zlib, glib2d) and libc's heap isn't known to be thread safe here,
+ * so nothing else may allocate until clock_tex_alloc_wait(), which has to be called before drawing
+ */
 int clock_tex_alloc(void)
 {
+  tex_load_start_time = sceKernelGetSystemTimeLow();
+
+  // Nothing to load
+  if (clock_glyphs == CLOCK_GLYPHS_SEGMENTS) return 0;
+
+#if TEX_LOAD_THREAD
+  tex_load_thid = sceKernelCreateThread("Texture Load Thread", tex_load_thread, 0x18, 0x10000, PSP_THREAD_ATTR_USER, NULL);
+
+  if ( tex_load_thid >= 0 && sceKernelStartThread(tex_load_thid, 0, NULL) < 0 )
+  {
+    sceKernelDeleteThread(tex_load_thid);
+    tex_load_thid = -1;
+  }
+
+  if (tex_load_thid >= 0) return 0;
+#endif
+
+  // No thread, loaded serially right away
+  tex_load_thread(0, NULL);
+  return 0;
+}
+
+// Waits until all textures are loaded
+int clock_tex_alloc_wait(void)
+{
+  if (tex_load_thid >= 0)
+  {
+    sceKernelWaitThreadEnd(tex_load_thid, NULL);
+    sceKernelDeleteThread(tex_load_thid);
+    tex_load_thid = -1;
+  }
+
+  clock_tex_load_time = sceKernelGetSystemTimeLow() - tex_load_start_time;
+
+  for (int tex_i = 0; tex_i < T_COUNT; tex_i++)
+  {
+    debug_printf("Texture '%s': %u us", main_clock_tex.a[tex_i].filename, main_clock_tex.a[tex_i].load_time);
+  }
+
+  sceKernelPrintf("Textures loaded in %u us", clock_tex_load_time);
+
+  if (clock_glyphs == CLOCK_GLYPHS_SEGMENTS) return 0;
+
   for (int tex_i = 0; tex_i < T_COUNT; tex_i++)
   {
-    int ret = app_tex_alloc(&main_clock_tex.a[tex_i]);
+    int ret = main_clock_tex.a[tex_i].load_err;
 
-    if (ret < 0)
+    if (ret >= 0) continue;
+
+    // Missing or out of memory, the clock still runs with seven segment glyphs
+    if ( ret == ERROR_TEXTURES_NOT_FOUND || ret == ERROR_ALLOCATING_TEXTURES )
     {
-      app_error_display(ret);
-      return -1;
+      sceKernelPrintf("Texture '%s' failed (%i), using seven segment glyphs", main_clock_tex.a[tex_i].filename, ret);
+
+      for (int free_i = 0; free_i < T_COUNT; free_i++)
+      {
+        if (main_clock_tex.a[free_i].tex) app_tex_free(&main_clock_tex.a[free_i]);
+      }
+
+      clock_glyphs = CLOCK_GLYPHS_SEGMENTS;
+      return 0;
     }
+
+    app_error_display(ret);
+    return -1;
   }
 
   return 0;
@@ -135,39 +266,188 @@ int clock_tex_free(void)
     app_tex_free(&main_clock_tex.a[tex_i]);
   }
 
+  g2dTexFree(&clock_time_tex);
+
   return 0;
 }
 
 int clock_build_curr_tex_draw(const ScePspDateTime* time)
 {
   // This shouldn't fail, if it fails, nothing will be drawn
-  if ( !time )
+  if ( !time || time->hour > 99 || time->minute > 99 || time->day > 99 || time->month > 99 )
   {
     return -1;
   }
 
-  int h_1digit = (time->hour / 10);
-  int h_2digit = (time->hour % 10);
+  const clock_digits* h = &clock_digits_lut[time->hour];
+  const clock_digits* mi = &clock_digits_lut[time->minute];
+  const clock_digits* d = &clock_digits_lut[time->day];
+  const clock_digits* mo = &clock_digits_lut[time->month];
 
-  int mi_1digit = (time->minute / 10);
-  int mi_2digit = (time->minute % 10);
+  app_tex* prev_time[4] = { curr_tex_draw.time[0], curr_tex_draw.time[1], curr_tex_draw.time[2], curr_tex_draw.time[3] };
+  cbool first_build = !curr_tex_draw.time[3];
 
-  int d_1digit = (time->day / 10);
-  int d_2digit = (time->day % 10);
+  // Organize tiles, if first tile is 0, don't draw
+  curr_tex_draw.time[0] = !h->lead_zero ? &main_clock_tex.a[h->tens] : NULL;
+  curr_tex_draw.time[1] = &main_clock_tex.a[h->ones];
+  curr_tex_draw.time[2] = &main_clock_tex.a[mi->tens];
+  curr_tex_draw.time[3] = &main_clock_tex.a[mi->ones];
 
-  int mo_1digit = (time->month / 10);
-  int mo_2digit = (time->month % 10);
+  curr_tex_draw.date[0] = !d->lead_zero ? &main_clock_tex.a[d->tens] : NULL;
+  curr_tex_draw.date[1] = &main_clock_tex.a[d->ones];
+  curr_tex_draw.date[2] = !mo->lead_zero ? &main_clock_tex.a[mo->tens] : NULL;
+  curr_tex_draw.date[3] = &main_clock_tex.a[mo->ones];
 
-  // Organize tiles, if first tile is 0, don't draw
-  curr_tex_draw.time[0] = h_1digit != 0 ? &main_clock_tex.a[h_1digit] : NULL;
-  curr_tex_draw.time[1] = &main_clock_tex.a[h_2digit];
-  curr_tex_draw.time[2] = &main_clock_tex.a[mi_1digit];
-  curr_tex_draw.time[3] = &main_clock_tex.a[mi_2digit];
+  clock_time_tex_dirty = TRUE;
 
-  curr_tex_draw.date[0] = d_1digit != 0 ? &main_clock_tex.a[d_1digit] : NULL;
-  curr_tex_draw.date[1] = &main_clock_tex.a[d_2digit];
-  curr_tex_draw.date[2] = mo_1digit != 0 ? &main_clock_tex.a[mo_1digit] : NULL;
-  curr_tex_draw.date[3] = &main_clock_tex.a[mo_2digit];
+  // Nothing to animate from when the clock starts
+  if ( !clock_time_anim_enabled || first_build ) return 0;
+
+  clock_time_anim_tiles = 0;
+
+  for ( int tile = 0; tile < 4; tile++ )
+  {
+    clock_time_anim_from[tile] = prev_time[tile];
+    if (prev_time[tile] != curr_tex_draw.time[tile]) clock_time_anim_tiles |= 1 << tile;
+  }
+
+  if ( clock_time_anim_tiles )
+  {
+    uint length = anim_track_length(&clock_anim_in_y);
+
+    clock_time_animating = TRUE;
+    clock_time_anim_start = sceKernelGetSystemTimeLow();
+    clock_time_anim_elapsed = 0;
+    anim_request(length);
+  }
+
+  return 0;
+}
+
+// Turning it off mid animation jumps straight to the new digits
+void clock_time_anim_enable(cbool enable)
+{
+  clock_time_anim_enabled = enable;
+  if (!enable) clock_time_animating = FALSE;
+}
+
+/* Advances the time digits animation, once per frame before drawing
+ * Returns 0 when they're not animating, otherwise something different every frame
+ */
+uint clock_time_anim_update(void)
+{
+  if (!clock_time_animating) return 0;
+
+  clock_time_anim_elapsed = (sceKernelGetSystemTimeLow() - clock_time_anim_start) / 1000;
+
+  if ( clock_time_anim_elapsed >= anim_track_length(&clock_anim_in_y) )
+  {
+    clock_time_animating = FALSE;
+    return 0;
+  }
+
+  return clock_time_anim_elapsed + 1;
+}
+
+/* Covers all 4 time tiles (of size each), needs g2dInit() first
+ * Not fatal, the digits are drawn one by one if there's no VRAM for it
+ */
+int clock_time_tex_alloc(const ScePspFVector2* size)
+{
+#if CLOCK_TIME_COMPOSE
+  if (!size) return -1;
+
+  clock_time_tex_origin.x = clock_tex_layout.time[0].x - size->x / 2.0f;
+  clock_time_tex_origin.y = clock_tex_layout.time[0].y - size->y / 2.0f;
+
+  int w = (int)(clock_tex_layout.time[3].x + size->x / 2.0f - clock_time_tex_origin.x);
+  int h = (int)size->y;
+
+  clock_time_tex = g2dTexCreateTarget(w, h);
+  clock_time_tex_dirty = TRUE;
+
+  return clock_time_tex ? 0 : -1;
+#else
+  (void)size;
+  return -1;
+#endif
+}
+
+static void clock_draw_time_tiles(const ScePspFVector2* origin, const ScePspFVector2* size, g2dColor color)
+{
+  for ( int tile = 0; tile < 4; tile++ )
+  {
+    // Draw if it's not NULL (eg.: first tile is 0)
+    if (!curr_tex_draw.time[tile]) continue;
+
+    ScePspFVector2 pos = { clock_tex_layout.time[tile].x - origin->x, clock_tex_layout.time[tile].y - origin->y };
+    tex_draw(curr_tex_draw.time[tile], &pos, size, color);
+  }
+}
+
+/* Composes the time digits again, only after clock_build_curr_tex_draw()
+ * Digits are white on black in the texture, so modulating it gives the same result on a black background
+ * Resets the scissor, call it before setting one
+ */
+void clock_time_tex_compose(const ScePspFVector2* size)
+{
+  if ( !clock_time_tex || !clock_time_tex_dirty || !size ) return;
+
+  g2dSetRenderTarget(clock_time_tex);
+  g2dClear(BLACK);
+  clock_draw_time_tiles(&clock_time_tex_origin, size, WHITE);
+  g2dSetRenderTarget(NULL);
+
+  clock_time_tex_dirty = FALSE;
+}
+
+// Draws the time digits
+int clock_draw_time(const ScePspFVector2* size, g2dColor color)
+{
+  static const ScePspFVector2 screen_origin = { 0.0f, 0.0f };
+
+  if (!size) return -1;
+
+  // Tiles move on their own while animating, so they're drawn one by one
+  if ( clock_time_animating )
+  {
+    uint t = clock_time_anim_elapsed;
+
+    for ( int tile = 0; tile < 4; tile++ )
+    {
+      const ScePspFVector2* pos = &clock_tex_layout.time[tile];
+
+      if ( !(clock_time_anim_tiles & (1 << tile)) )
+      {
+        if (curr_tex_draw.time[tile]) tex_draw(curr_tex_draw.time[tile], pos, size, color);
+        continue;
+      }
+
+      ScePspFVector2 out_pos = { pos->x, pos->y + anim_track_value(&clock_anim_out_y, t) };
+      ScePspFVector2 in_pos = { pos->x, pos->y + anim_track_value(&clock_anim_in_y, t) };
+
+      // Either one can be NULL (leading 0), tex_draw() skips it
+      tex_draw(clock_time_anim_from[tile], &out_pos, size, G2D_MODULATE(color, 255, anim_track_value(&clock_anim_out_a, t)));
+      tex_draw(curr_tex_draw.time[tile], &in_pos, size, G2D_MODULATE(color, 255, anim_track_value(&clock_anim_in_a, t)));
+    }
+
+    return 0;
+  }
+
+  if (!clock_time_tex)
+  {
+    clock_draw_time_tiles(&screen_origin, size, color);
+    return 0;
+  }
+
+  clock_time_tex_compose(size);
+
+  g2dBeginRects(clock_time_tex);
+  g2dSetCoordMode(G2D_UP_LEFT);
+  g2dSetCoordXY(clock_time_tex_origin.x, clock_time_tex_origin.y);
+  g2dSetColor(color);
+  g2dAdd();
+  g2dEnd();
 
   return 0;
 }
@@ -179,6 +459,11 @@ int tex_draw(app_tex* tex, const ScePspFVector2* pos, const ScePspFVector2* size
   {
     return -1;
   }
+
+  if (clock_glyphs == CLOCK_GLYPHS_SEGMENTS)
+  {
+    return segment_draw(tex - main_clock_tex.a, pos, size, color);
+  }
   
   // Render texture on screen with params
   g2dBeginRects(tex->tex);
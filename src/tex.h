@@ -23,11 +23,31 @@
 #include <psprtc.h>
 
 #include "lib/glib2d/glib2d.h"
+#include "utils.h"
+
+// Textures are decoded on a thread alongside main(), 0 loads them serially
+#define TEX_LOAD_THREAD 1
+
+// 1 composes the time digits into one VRAM texture when they change, 0 draws them one by one every frame
+// Off: the composed sprite also covers the gaps between digits, 14 vertices and 70400 px per frame against 8 and 51200
+#define CLOCK_TIME_COMPOSE 0
+
+// How far changing time digits slide while they fade, in px
+#define CLOCK_TIME_ANIM_SLIDE 16.0f
+
+// How glyphs are drawn, textures unless they can't be loaded
+enum
+{
+  CLOCK_GLYPHS_TEXTURES,
+  CLOCK_GLYPHS_SEGMENTS,  // Untextured seven segment sprites, see segment.c
+};
 
 typedef struct 
 {
   const char* filename;
   g2dTexture* tex;
+  int load_err;
+  uint load_time; // us
 } app_tex;
 
 enum 
@@ -77,12 +97,38 @@ struct clock_tex_draw
   app_tex* date[4];
 };
 
+// Where each tile of clock_tex_draw goes on screen (center)
+struct clock_tex_layout
+{
+  ScePspFVector2 time[4];
+  ScePspFVector2 date[4];
+};
+
+// 0-99 as two digit glyphs (T_ZERO...T_NINE)
+typedef struct
+{
+  uchar tens;
+  uchar ones;
+  cbool lead_zero;
+} clock_digits;
+
 extern union clock_tex main_clock_tex;
 extern struct clock_tex_draw curr_tex_draw;
+extern const struct clock_tex_layout clock_tex_layout;
+extern const clock_digits clock_digits_lut[100];
+extern uint clock_tex_load_time;
+extern g2dTexture* clock_time_tex;
+extern int clock_glyphs;
 
 int clock_tex_alloc(void);
+int clock_tex_alloc_wait(void);
 int clock_tex_free(void);
 int clock_build_curr_tex_draw(const ScePspDateTime* time);
+int clock_time_tex_alloc(const ScePspFVector2* size);
+void clock_time_tex_compose(const ScePspFVector2* size);
+void clock_time_anim_enable(cbool enable);
+uint clock_time_anim_update(void);
+int clock_draw_time(const ScePspFVector2* size, g2dColor color);
 int tex_draw(app_tex* tex, const ScePspFVector2* pos, const ScePspFVector2* size, g2dColor color);
 
 #endif /* TEX_H_ */
\ No newline at end of file
@@ -72,6 +72,16 @@ cbool str_endswith(const char *str, const char* endswith)
   return !strcasecmp(str + strlen(str) - strlen(endswith), endswith);
 }
 
+// FNV-1a, never 0 so that can mean "none"
+uint str_hash(const char* str)
+{
+  uint hash = 2166136261u;
+
+  while (*str) hash = (hash ^ (byte)*str++) * 16777619u;
+
+  return hash ? hash : 1;
+}
+
 uint get_rand_range_uint(uint min, uint max)
 {
   return (rand() % (max - min + 1)) + min;
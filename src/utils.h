@@ -23,6 +23,15 @@
 typedef unsigned int uint;
 typedef unsigned char uchar, cbool, byte;
 
+// Uncomment for per-event diagnostics on the kernel log
+// #define DEBUG_LOG
+
+#ifdef DEBUG_LOG
+#define debug_printf(...) sceKernelPrintf(__VA_ARGS__)
+#else
+#define debug_printf(...) ((void)0)
+#endif
+
 #define FALSE 0
 #define TRUE  1
 
@@ -56,6 +65,7 @@ typedef struct
 
 void get_app_v_string(const app_info* app_inf);
 cbool str_endswith(const char *str, const char* endswith);
+uint str_hash(const char* str);
 uint get_rand_range_uint(uint min, uint max);
 
 #define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
@@ -0,0 +1,121 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "src/alarm.h"
+#include "src/clocktime.h"
+
+#define MINUTE(day, hour, minute) ((day) * ALARM_DAY_MINUTES + (hour) * 60 + (minute))
+
+enum { SUN, MON, TUE, WED, THU, FRI, SAT };
+
+static void test_parse(void)
+{
+  alarm_config cfg;
+
+  CHECK_EQ(alarm_parse(&cfg, "07:30\n"), 1);
+  CHECK_EQ(cfg.list[0].hour, 7);
+  CHECK_EQ(cfg.list[0].minute, 30);
+  CHECK_EQ(cfg.list[0].days, 0x7F);
+  CHECK(cfg.list[0].enabled);
+
+  // Comments, bad times and CRLF line endings
+  CHECK_EQ(alarm_parse(&cfg, "# weekdays\r\n06:45 -MTWTF-\r\n24:00\r\n12:60\r\n23:59 S-----S"), 2);
+  CHECK_EQ(cfg.list[0].days, 0x3E);
+  CHECK_EQ(cfg.list[1].hour, 23);
+  CHECK_EQ(cfg.list[1].days, (1 << SUN) | (1 << SAT));
+
+  // Only ALARM_MAX are kept
+  char text[(ALARM_MAX + 2) * 6 + 1] = "";
+  for (int i = 0; i < ALARM_MAX + 2; i++) strcat(text, "01:00\n");
+  CHECK_EQ(alarm_parse(&cfg, text), ALARM_MAX);
+
+  CHECK_EQ(alarm_parse(&cfg, ""), 0);
+  CHECK_EQ(alarm_parse(NULL, ""), -1);
+}
+
+static void test_next_minute(void)
+{
+  alarm_config cfg;
+
+  alarm_parse(&cfg, "");
+  CHECK_EQ(alarm_next_minute(&cfg, 0), -1);
+
+  // Every day, across midnight
+  alarm_parse(&cfg, "00:10");
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(MON, 23, 55)), MINUTE(TUE, 0, 10));
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(SAT, 23, 55)), MINUTE(SUN, 0, 10));
+
+  // At the alarm's own minute it's the one coming
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(WED, 0, 10)), MINUTE(WED, 0, 10));
+
+  // Only on Sundays, across the end of the week
+  alarm_parse(&cfg, "07:30 S------");
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(SAT, 23, 0)), MINUTE(SUN, 7, 30));
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(SUN, 7, 31)), MINUTE(SUN, 7, 30));
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(SUN, 7, 29)), MINUTE(SUN, 7, 30));
+
+  // The closest of a few, disabled ones are skipped
+  alarm_parse(&cfg, "09:00 -M-----\n08:00 --T----\n06:00");
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(MON, 8, 0)), MINUTE(MON, 9, 0));
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(MON, 9, 1)), MINUTE(TUE, 6, 0));
+  cfg.list[2].enabled = FALSE;
+  CHECK_EQ(alarm_next_minute(&cfg, MINUTE(MON, 9, 1)), MINUTE(TUE, 8, 0));
+}
+
+static void test_time_until(void)
+{
+  // Monday 2025-06-02, a minute before the alarm
+  ScePspDateTime now = { .year = 2025, .month = 6, .day = 2, .hour = 7, .minute = 29, .second = 0 };
+
+  alarm_parse(&alarm_cfg, "07:30 -M-----");
+  alarm_cfg.armed = TRUE;
+
+  CHECK(!alarm_update(&now, CLOCK_TIME_MINUTE));
+  CHECK_EQ(alarm_time_until(&now), 60 * 1000000);
+
+  now.second = 59;
+  now.microsecond = 500000;
+  CHECK_EQ(alarm_time_until(&now), 500000);
+
+  now.minute = 30;
+  now.second = 0;
+  now.microsecond = 0;
+  CHECK(alarm_update(&now, CLOCK_TIME_MINUTE));
+  CHECK(alarm_ringing());
+
+  // Rang this minute, so the next one is a week away (more than a uint of us), not due now
+  now.second = 10;
+  CHECK_EQ(alarm_time_until(&now), ALARM_NONE);
+
+  alarm_dismiss();
+  alarm_set_armed(FALSE);
+  CHECK_EQ(alarm_time_until(&now), ALARM_NONE);
+}
+
+int main(void)
+{
+  test_parse();
+  test_next_minute();
+  test_time_until();
+
+  return test_result("alarm");
+}
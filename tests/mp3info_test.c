@@ -0,0 +1,335 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#include "test.h"
+#include "src/mp3info.h"
+
+// MPEG1 layer III, 128 kbit/s, 44100 Hz, stereo: 417 bytes (418 padded)
+#define FRAME_SIZE 417
+
+static void put_header(byte* at, byte b1, byte b2, byte b3)
+{
+  at[0] = 0xFF;
+  at[1] = b1;
+  at[2] = b2;
+  at[3] = b3;
+}
+
+static void put_frame(byte* at)
+{
+  put_header(at, 0xFB, 0x90, 0x00);
+}
+
+static void put_be32(byte* at, uint value)
+{
+  at[0] = value >> 24;
+  at[1] = value >> 16;
+  at[2] = value >> 8;
+  at[3] = value;
+}
+
+static void put_le32(byte* at, uint value)
+{
+  at[0] = value;
+  at[1] = value >> 8;
+  at[2] = value >> 16;
+  at[3] = value >> 24;
+}
+
+static void put_id3v2(byte* at, byte version, byte flags, uint size)
+{
+  memcpy(at, "ID3", 3);
+  at[3] = version;
+  at[4] = 0;
+  at[5] = flags;
+
+  // Syncsafe, 7 bits per byte
+  at[6] = (size >> 21) & 0x7F;
+  at[7] = (size >> 14) & 0x7F;
+  at[8] = (size >> 7) & 0x7F;
+  at[9] = size & 0x7F;
+}
+
+static void test_id3v2_size(void)
+{
+  byte buf[64] = { 0 };
+
+  put_id3v2(buf, 3, 0, 257);
+  CHECK_EQ(mp3_id3v2_size(buf, sizeof(buf)), 10 + 257);
+
+  // ID3v2.4 footer
+  put_id3v2(buf, 4, 0x10, 257);
+  CHECK_EQ(mp3_id3v2_size(buf, sizeof(buf)), 10 + 257 + 10);
+
+  put_id3v2(buf, 4, 0, 0x0FFFFFFF);
+  CHECK_EQ(mp3_id3v2_size(buf, sizeof(buf)), 10 + 0x0FFFFFFF);
+
+  // Chained tags are sized one at a time
+  put_id3v2(buf, 3, 0, 6);
+  put_id3v2(buf + 16, 4, 0, 20);
+  uint first = mp3_id3v2_size(buf, sizeof(buf));
+  CHECK_EQ(first, 16);
+  CHECK_EQ(mp3_id3v2_size(buf + first, sizeof(buf) - first), 30);
+
+  // Not a tag: a size byte with its top bit set, a 0xFF version, cut short, no "ID3"
+  put_id3v2(buf, 3, 0, 257);
+  buf[8] |= 0x80;
+  CHECK_EQ(mp3_id3v2_size(buf, sizeof(buf)), 0);
+
+  put_id3v2(buf, 0xFF, 0, 257);
+  CHECK_EQ(mp3_id3v2_size(buf, sizeof(buf)), 0);
+
+  put_id3v2(buf, 3, 0, 257);
+  CHECK_EQ(mp3_id3v2_size(buf, 9), 0);
+  CHECK_EQ(mp3_id3v2_size(NULL, sizeof(buf)), 0);
+
+  memcpy(buf, "ID4", 3);
+  CHECK_EQ(mp3_id3v2_size(buf, sizeof(buf)), 0);
+}
+
+static void test_frame_parse(void)
+{
+  byte buf[4];
+  mp3_frame frame;
+
+  put_frame(buf);
+  CHECK_EQ(mp3_frame_parse(buf, &frame), 0);
+  CHECK_EQ(frame.version, MP3_MPEG1);
+  CHECK_EQ(frame.channels, 2);
+  CHECK_EQ(frame.bitrate, 128);
+  CHECK_EQ(frame.sample_rate, 44100);
+  CHECK_EQ(frame.samples, 1152);
+  CHECK_EQ(frame.size, FRAME_SIZE);
+
+  // Padded, mono
+  put_header(buf, 0xFB, 0x92, 0xC0);
+  CHECK_EQ(mp3_frame_parse(buf, &frame), 0);
+  CHECK_EQ(frame.size, FRAME_SIZE + 1);
+  CHECK_EQ(frame.channels, 1);
+
+  // MPEG2, 64 kbit/s, 22050 Hz and MPEG2.5, 32 kbit/s, 8000 Hz
+  put_header(buf, 0xF3, 0x80, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, &frame), 0);
+  CHECK_EQ(frame.version, MP3_MPEG2);
+  CHECK_EQ(frame.samples, 576);
+  CHECK_EQ(frame.size, 208);
+
+  put_header(buf, 0xE3, 0x48, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, &frame), 0);
+  CHECK_EQ(frame.version, MP3_MPEG25);
+  CHECK_EQ(frame.sample_rate, 8000);
+  CHECK_EQ(frame.size, 288);
+
+  // Layer II, reserved version, free format and bad bitrate, reserved sample rate, no sync
+  put_header(buf, 0xFD, 0x90, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, NULL), -1);
+  put_header(buf, 0xEB, 0x90, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, NULL), -1);
+  put_header(buf, 0xFB, 0x00, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, NULL), -1);
+  put_header(buf, 0xFB, 0xF0, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, NULL), -1);
+  put_header(buf, 0xFB, 0x9C, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, NULL), -1);
+  put_header(buf, 0xDB, 0x90, 0x00);
+  CHECK_EQ(mp3_frame_parse(buf, NULL), -1);
+}
+
+static void test_frame_find(void)
+{
+  static byte buf[2048];
+  mp3_frame frame;
+
+  // Two frames in a row after some junk
+  memset(buf, 0, sizeof(buf));
+  put_frame(buf + 100);
+  put_frame(buf + 100 + FRAME_SIZE);
+  CHECK_EQ(mp3_frame_find(buf, sizeof(buf), &frame), 100);
+  CHECK_EQ(frame.size, FRAME_SIZE);
+
+  // A false sync in leftover tag data, with no frame where its next one would be
+  put_frame(buf + 10);
+  CHECK_EQ(mp3_frame_find(buf, sizeof(buf), NULL), 100);
+
+  // Or a next frame that doesn't agree with it
+  put_header(buf + 10 + FRAME_SIZE, 0xF3, 0x80, 0x00);
+  CHECK_EQ(mp3_frame_find(buf, sizeof(buf), NULL), 100);
+
+  // With its next one past the end of buf, a frame is taken as it is
+  memset(buf, 0, sizeof(buf));
+  put_frame(buf + 1800);
+  CHECK_EQ(mp3_frame_find(buf, sizeof(buf), NULL), 1800);
+
+  // Headers cut short by the end of buf aren't read
+  memset(buf, 0, sizeof(buf));
+  put_frame(buf + sizeof(buf) - 4);
+  CHECK_EQ(mp3_frame_find(buf, sizeof(buf) - 1, NULL), -1);
+  CHECK_EQ(mp3_frame_find(buf, sizeof(buf), NULL), sizeof(buf) - 4);
+
+  memset(buf, 0xFF, sizeof(buf));
+  CHECK_EQ(mp3_frame_find(buf, sizeof(buf), NULL), -1);
+  CHECK_EQ(mp3_frame_find(buf, 3, NULL), -1);
+  CHECK_EQ(mp3_frame_find(NULL, sizeof(buf), NULL), -1);
+}
+
+static void put_ape_footer(byte* at, uint size, cbool has_header)
+{
+  memset(at, 0, 32);
+  memcpy(at, "APETAGEX", 8);
+  put_le32(at + 8, 2000);
+  put_le32(at + 12, size);
+  put_le32(at + 20, has_header ? 0x80000000 : 0);
+}
+
+static void test_trailer_size(void)
+{
+  byte tail[MP3_TRAILER_PROBE_SIZE];
+
+  memset(tail, 0, sizeof(tail));
+  CHECK_EQ(mp3_trailer_size(tail, sizeof(tail)), 0);
+
+  // ID3v1
+  memcpy(tail + sizeof(tail) - 128, "TAG", 3);
+  CHECK_EQ(mp3_trailer_size(tail, sizeof(tail)), 128);
+
+  // APEv2 right before it, with a header
+  put_ape_footer(tail, 200, TRUE);
+  CHECK_EQ(mp3_trailer_size(tail, sizeof(tail)), 128 + 200 + 32);
+
+  // APEv2 last, without a header
+  memset(tail, 0, sizeof(tail));
+  put_ape_footer(tail + sizeof(tail) - 32, 100, FALSE);
+  CHECK_EQ(mp3_trailer_size(tail, sizeof(tail)), 100);
+
+  // Too short for an APEv2 footer, or for anything
+  CHECK_EQ(mp3_trailer_size(tail + sizeof(tail) - 31, 31), 0);
+  CHECK_EQ(mp3_trailer_size(NULL, sizeof(tail)), 0);
+}
+
+// Xing / Info header at at, with every field, and a LAME tag after it
+static void put_xing(byte* at, const char* id, uint frames, uint delay, uint padding)
+{
+  memcpy(at, id, 4);
+  put_be32(at + 4, 0xF);
+  put_be32(at + 8, frames);
+  put_be32(at + 12, frames * FRAME_SIZE);
+
+  byte* lame = at + 8 + 4 + 4 + 100 + 4;
+  memcpy(lame, "LAME", 4);
+  lame[21] = delay >> 4;
+  lame[22] = ((delay & 0x0F) << 4) | (padding >> 8);
+  lame[23] = padding;
+}
+
+static void test_info_parse(void)
+{
+  static byte buf[MP3_PROBE_SIZE];
+  mp3_info info;
+
+  // CBR: the duration comes from the stream size
+  memset(buf, 0, sizeof(buf));
+  put_frame(buf);
+  info.stream_start = 1000;
+  info.stream_end = 1000 + 417000;
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.frames, 0);
+  CHECK_EQ(info.bitrate, 128);
+  CHECK_EQ(info.duration, 417000 * 8 / 128);
+
+  // Xing after MPEG1 stereo side info, minus the LAME encoder delay and padding
+  put_xing(buf + 4 + 32, "Xing", 1000, 576, 1000);
+  info.stream_start = 0;
+  info.stream_end = 1000 * FRAME_SIZE;
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.frames, 1000);
+  CHECK_EQ(info.duration, (1000 * 1152 - 576 - 1000) * 1000ULL / 44100);
+  CHECK_EQ(info.bitrate, 1000 * FRAME_SIZE * 8ULL / info.duration);
+
+  // More delay and padding than samples is ignored
+  put_xing(buf + 4 + 32, "Info", 1, 1000, 1000);
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.frames, 1);
+  CHECK_EQ(info.duration, 1152 * 1000 / 44100);
+
+  // Mono MPEG1 side info is shorter
+  memset(buf, 0, sizeof(buf));
+  put_header(buf, 0xFB, 0x90, 0xC0);
+  put_xing(buf + 4 + 17, "Xing", 500, 0, 0);
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.frames, 500);
+  CHECK_EQ(info.duration, 500 * 1152 * 1000ULL / 44100);
+
+  // MPEG2, stereo and mono
+  memset(buf, 0, sizeof(buf));
+  put_header(buf, 0xF3, 0x80, 0x00);
+  put_xing(buf + 4 + 17, "Xing", 500, 0, 0);
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.duration, 500 * 576 * 1000ULL / 22050);
+
+  memset(buf, 0, sizeof(buf));
+  put_header(buf, 0xF3, 0x80, 0xC0);
+  put_xing(buf + 4 + 9, "Info", 500, 0, 0);
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.frames, 500);
+
+  // Xing without a frame count, or cut off by the end of buf, is CBR
+  memset(buf, 0, sizeof(buf));
+  put_frame(buf);
+  put_xing(buf + 4 + 32, "Xing", 1000, 0, 0);
+  buf[4 + 32 + 7] = 0xE;
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.frames, 0);
+  CHECK_EQ(info.bitrate, 128);
+
+  buf[4 + 32 + 7] = 0xF;
+  CHECK_EQ(mp3_info_parse(buf, 4 + 32 + 10, &info), 0);
+  CHECK_EQ(info.frames, 0);
+
+  // VBRI, 32 bytes after the header whatever the side info
+  memset(buf, 0, sizeof(buf));
+  put_frame(buf);
+  memcpy(buf + 4 + 32, "VBRI", 4);
+  put_be32(buf + 4 + 32 + 14, 2000);
+  info.stream_end = 2000 * FRAME_SIZE;
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), &info), 0);
+  CHECK_EQ(info.frames, 2000);
+  CHECK_EQ(info.duration, 2000 * 1152 * 1000ULL / 44100);
+  CHECK_EQ(info.bitrate, 2000 * FRAME_SIZE * 8ULL / info.duration);
+
+  CHECK_EQ(mp3_info_parse(buf, 4 + 32 + 17, &info), 0);
+  CHECK_EQ(info.frames, 0);
+
+  // Has to start with a frame
+  CHECK_EQ(mp3_info_parse(buf + 1, sizeof(buf) - 1, &info), -1);
+  CHECK_EQ(mp3_info_parse(buf, 3, &info), -1);
+  CHECK_EQ(mp3_info_parse(buf, sizeof(buf), NULL), -1);
+}
+
+int main(void)
+{
+  test_id3v2_size();
+  test_frame_parse();
+  test_frame_find();
+  test_trailer_size();
+  test_info_parse();
+
+  return test_result("mp3info");
+}
@@ -0,0 +1,15 @@
+/* Host stand-in for the PSPSDK header, only what the tested sources use */
+
+#ifndef PSPAUDIO_H
+#define PSPAUDIO_H
+
+#define PSP_AUDIO_VOLUME_MAX 0x8000
+#define PSP_AUDIO_NEXT_CHANNEL (-1)
+#define PSP_AUDIO_FORMAT_MONO 0x10
+
+int sceAudioChReserve(int channel, int samplecount, int format);
+int sceAudioChRelease(int channel);
+int sceAudioOutput(int channel, int vol, void* buf);
+int sceAudioGetChannelRestLen(int channel);
+
+#endif /* PSPAUDIO_H */
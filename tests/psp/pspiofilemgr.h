@@ -0,0 +1,18 @@
+/* Host stand-in for the PSPSDK header, only what the tested sources use */
+
+#ifndef PSPIOFILEMGR_H
+#define PSPIOFILEMGR_H
+
+#include "psptypes.h"
+
+#define PSP_O_RDONLY 0x0001
+#define PSP_O_WRONLY 0x0002
+#define PSP_O_CREAT  0x0200
+#define PSP_O_TRUNC  0x0400
+
+SceUID sceIoOpen(const char* file, int flags, SceMode mode);
+int sceIoClose(SceUID fd);
+int sceIoRead(SceUID fd, void* data, SceSize size);
+int sceIoWrite(SceUID fd, const void* data, SceSize size);
+
+#endif /* PSPIOFILEMGR_H */
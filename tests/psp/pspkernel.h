@@ -0,0 +1,12 @@
+/* Host stand-in for the PSPSDK header, only what the tested sources use */
+
+#ifndef PSPKERNEL_H
+#define PSPKERNEL_H
+
+#include "psptypes.h"
+
+int sceKernelDelayThread(unsigned int delay);
+unsigned int sceKernelGetSystemTimeLow(void);
+SceInt64 sceKernelGetSystemTimeWide(void);
+
+#endif /* PSPKERNEL_H */
@@ -0,0 +1,10 @@
+/* Host stand-in for the PSPSDK header, only what the tested sources use */
+
+#ifndef PSPRTC_H
+#define PSPRTC_H
+
+#include "psptypes.h"
+
+int sceRtcGetDayOfWeek(int year, int month, int day);
+
+#endif /* PSPRTC_H */
@@ -0,0 +1,27 @@
+/* Host stand-in for the PSPSDK header, only what the tested sources use */
+
+#ifndef PSPTYPES_H
+#define PSPTYPES_H
+
+#include <stdint.h>
+
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef int SceMode;
+typedef long long SceInt64;
+
+typedef struct ScePspDateTime
+{
+  unsigned short year;
+  unsigned short month;
+  unsigned short day;
+  unsigned short hour;
+  unsigned short minute;
+  unsigned short second;
+  unsigned int microsecond;
+} ScePspDateTime;
+
+#endif /* PSPTYPES_H */
@@ -0,0 +1,97 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Firmware calls the tested sources link against, nothing here touches real hardware
+
+#include <string.h>
+#include <pspkernel.h>
+#include <pspiofilemgr.h>
+#include <pspaudio.h>
+#include <psprtc.h>
+
+#include "src/music.h"
+#include "test.h"
+
+unsigned int test_time_us = 0;
+
+int sceKernelDelayThread(unsigned int delay) { test_time_us += delay; return 0; }
+unsigned int sceKernelGetSystemTimeLow(void) { return test_time_us; }
+SceInt64 sceKernelGetSystemTimeWide(void) { return test_time_us; }
+
+// Every path opens the same file in memory, missing while test_file_size < 0
+unsigned char test_file[TEST_FILE_MAX];
+int test_file_size = -1;
+static int test_file_pos = 0;
+
+SceUID sceIoOpen(const char* file, int flags, SceMode mode)
+{
+  (void)file; (void)mode;
+
+  if (flags & PSP_O_TRUNC) test_file_size = 0;
+  if (test_file_size < 0) return -1;
+
+  test_file_pos = 0;
+  return 1;
+}
+
+int sceIoClose(SceUID fd) { (void)fd; return 0; }
+
+int sceIoRead(SceUID fd, void* data, SceSize size)
+{
+  (void)fd;
+
+  int read = test_file_size - test_file_pos;
+  if (read > (int)size) read = size;
+
+  memcpy(data, test_file + test_file_pos, read);
+  test_file_pos += read;
+
+  return read;
+}
+
+int sceIoWrite(SceUID fd, const void* data, SceSize size)
+{
+  (void)fd;
+
+  int written = TEST_FILE_MAX - test_file_pos;
+  if (written > (int)size) written = size;
+
+  memcpy(test_file + test_file_pos, data, written);
+  test_file_pos += written;
+  if (test_file_pos > test_file_size) test_file_size = test_file_pos;
+
+  return written;
+}
+
+int sceAudioChReserve(int channel, int samplecount, int format) { (void)channel; (void)samplecount; (void)format; return -1; }
+int sceAudioChRelease(int channel) { (void)channel; return -1; }
+int sceAudioOutput(int channel, int vol, void* buf) { (void)channel; (void)vol; (void)buf; return -1; }
+int sceAudioGetChannelRestLen(int channel) { (void)channel; return 0; }
+
+// 0 is Sunday, like the firmware
+int sceRtcGetDayOfWeek(int year, int month, int day)
+{
+  static const int offsets[] = { 0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4 };
+
+  if (month < 3) year--;
+  return (year + year / 4 - year / 100 + year / 400 + offsets[month - 1] + day) % 7;
+}
+
+cbool music_cmd_send(uchar type, int arg) { (void)type; (void)arg; return FALSE; }
+cbool music_enabled() { return FALSE; }
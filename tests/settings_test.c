@@ -0,0 +1,180 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <pspaudio.h>
+
+#include "test.h"
+#include "src/settings.h"
+
+static app_settings test_settings(void)
+{
+  app_settings s;
+
+  settings_defaults(&s);
+  s.color = 3;
+  s.brightness = 1;
+  s.music_on = TRUE;
+  s.alarms_armed = FALSE;
+  s.track = 0x12345678;
+  s.volume = PSP_AUDIO_VOLUME_MAX / 2;
+
+  return s;
+}
+
+static void test_round_trip(void)
+{
+  app_settings s = test_settings(), out;
+  settings_file file;
+
+  settings_encode(&s, &file);
+  CHECK_EQ(file.magic, SETTINGS_MAGIC);
+  CHECK_EQ(file.version, SETTINGS_VERSION);
+  CHECK_EQ(file.size, sizeof(app_settings));
+  CHECK_EQ(settings_decode(&file, &out), 0);
+  CHECK(!memcmp(&s, &out, sizeof(app_settings)));
+}
+
+static void test_corrupt(void)
+{
+  app_settings s = test_settings(), out, before;
+  settings_file file, good;
+
+  settings_encode(&s, &good);
+  settings_defaults(&out);
+  before = out;
+
+  file = good;
+  file.magic ^= 1;
+  CHECK_EQ(settings_decode(&file, &out), -1);
+
+  file = good;
+  file.version = SETTINGS_VERSION - 1;
+  CHECK_EQ(settings_decode(&file, &out), -1);
+
+  file = good;
+  file.size = sizeof(app_settings) - 4;
+  CHECK_EQ(settings_decode(&file, &out), -1);
+
+  // A flipped bit in the data or in the FNV-1a itself
+  file = good;
+  file.data.color ^= 0x10;
+  CHECK_EQ(settings_decode(&file, &out), -1);
+
+  file = good;
+  file.checksum ^= 0x80000000;
+  CHECK_EQ(settings_decode(&file, &out), -1);
+
+  // Zeroed file (e.g. cut short by a power loss)
+  memset(&file, 0, sizeof(file));
+  CHECK_EQ(settings_decode(&file, &out), -1);
+
+  CHECK(!memcmp(&out, &before, sizeof(app_settings)));
+
+  // Out of range values with a good checksum are reset one by one
+  s.music_on = 7;
+  s.volume = PSP_AUDIO_VOLUME_MAX + 1;
+  settings_encode(&s, &file);
+  CHECK_EQ(settings_decode(&file, &out), 0);
+  CHECK_EQ(out.music_on, FALSE);
+  CHECK_EQ(out.volume, PSP_AUDIO_VOLUME_MAX);
+  CHECK_EQ(out.color, 3);
+  CHECK_EQ(out.track, 0x12345678);
+}
+
+static void test_load_save(void)
+{
+  app_settings defaults;
+  settings_file file;
+
+  settings_defaults(&defaults);
+
+  // No file, then a short one
+  test_file_size = -1;
+  CHECK_EQ(settings_load(), -1);
+  CHECK(!memcmp(&settings, &defaults, sizeof(app_settings)));
+
+  settings_encode(&defaults, &file);
+  file.data.color = 2;
+  file.checksum = settings_checksum(&file.data);
+  memcpy(test_file, &file, sizeof(file));
+  test_file_size = sizeof(file) - 1;
+  CHECK_EQ(settings_load(), -1);
+  CHECK(!memcmp(&settings, &defaults, sizeof(app_settings)));
+
+  test_file_size = sizeof(file);
+  CHECK_EQ(settings_load(), 0);
+  CHECK_EQ(settings.color, 2);
+
+  // Unchanged settings aren't written
+  uint writes = settings_writes;
+  CHECK_EQ(settings_save(), 0);
+  CHECK_EQ(settings_writes, writes);
+
+  settings = test_settings();
+  CHECK_EQ(settings_save(), 0);
+  CHECK_EQ(settings_writes, writes + 1);
+  CHECK_EQ(test_file_size, sizeof(settings_file));
+
+  settings_defaults(&settings);
+  CHECK_EQ(settings_load(), 0);
+  app_settings expected = test_settings();
+  CHECK(!memcmp(&settings, &expected, sizeof(app_settings)));
+}
+
+static void test_update(void)
+{
+  test_file_size = -1;
+  settings_load();
+  test_file_size = 0;
+
+  uint writes = settings_writes;
+
+  // Every change restarts the wait
+  settings.color = 1;
+  settings_update();
+  test_time_us += SETTINGS_SAVE_DELAY - 1;
+  settings_update();
+  CHECK_EQ(settings_writes, writes);
+
+  settings.color = 2;
+  settings_update();
+  test_time_us += SETTINGS_SAVE_DELAY - 1;
+  settings_update();
+  CHECK_EQ(settings_writes, writes);
+
+  test_time_us += 1;
+  settings_update();
+  CHECK_EQ(settings_writes, writes + 1);
+
+  // Nothing left to write
+  test_time_us += SETTINGS_SAVE_DELAY;
+  settings_update();
+  CHECK_EQ(settings_writes, writes + 1);
+}
+
+int main(void)
+{
+  test_round_trip();
+  test_corrupt();
+  test_load_save();
+  test_update();
+
+  return test_result("settings");
+}
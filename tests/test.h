@@ -0,0 +1,63 @@
+/*
+ *  Digital Clock for PSP
+ *
+ *  Copyright (C) 2025, danssmnt
+ *  
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *  
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+// psp_stubs.c: the one file sceIo* calls see, test_file_size < 0 if it's missing
+#define TEST_FILE_MAX 4096
+extern unsigned char test_file[TEST_FILE_MAX];
+extern int test_file_size;
+
+// psp_stubs.c: what sceKernelGetSystemTime*() return, sceKernelDelayThread() moves it forward
+extern unsigned int test_time_us;
+
+// Keeps going after a failure, so one run shows all of them
+#define CHECK(cond) \
+  do \
+  { \
+    if (!(cond)) \
+    { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(a, b) \
+  do \
+  { \
+    long long a_ = (long long)(a), b_ = (long long)(b); \
+    if (a_ != b_) \
+    { \
+      printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, a_, b_); \
+      test_failures++; \
+    } \
+  } while (0)
+
+static inline int test_result(const char* name)
+{
+  printf("%s: %s\n", name, test_failures ? "FAILED" : "passed");
+  return test_failures ? 1 : 0;
+}
+
+#endif /* TEST_H_ */